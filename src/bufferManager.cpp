@@ -3,93 +3,267 @@
 BufferManager::BufferManager()
 {
     logger.log("BufferManager::BufferManager");
+    this->policy.reset(createReplacementPolicy("FIFO"));
 }
 
 /**
  * @brief Function called to read a page from the buffer manager. If the page is
- * not present in the pool, the page is read and then inserted into the pool.
+ * not present in the pool, the page is read (or taken from the read-ahead
+ * staging area) and then inserted into the pool. The returned handle pins the
+ * page for as long as it is held.
  *
  * @param tableName 
  * @param pageIndex 
- * @return Page 
+ * @return PageHandle 
  */
-Page BufferManager::getPage(string tableName, int pageIndex)
+PageHandle BufferManager::getPage(string tableName, int pageIndex)
 {
     logger.log("BufferManager::getPage");
-    string pageName = "../data/temp/"+tableName + "_Page" + to_string(pageIndex);
-    if (this->inPool(pageName))
-        return this->getFromPool(pageName);
+    uint64_t pageKey = this->getPageKey(tableName, pageIndex);
+    BufferStatistics &statistics = this->statistics[this->policy->getName()];
+    auto frame = this->frames.find(pageKey);
+    if (frame != this->frames.end())
+    {
+        statistics.hits++;
+        this->policy->recordAccess(pageKey);
+        return frame->second;
+    }
+    statistics.misses++;
+    PageHandle page;
+    if (this->mappedReads)
+    {
+        Segment &segment = this->openSegment(tableName);
+        page = make_shared<Page>(tableName, pageIndex, this->mapSegment(segment, (size_t)(pageIndex + 1) * Page::pageSize()));
+        return this->insertIntoPool(pageKey, page);
+    }
+    page = this->prefetcher.claim(pageKey);
+    if (page)
+        statistics.prefetched++;
     else
-        return this->insertIntoPool(tableName, pageIndex);
+        page = make_shared<Page>(tableName, pageIndex);
+    return this->insertIntoPool(pageKey, page);
 }
 
 /**
- * @brief Checks to see if a page exists in the pool
+ * @brief Returns a mapping of the segment that covers its first length bytes,
+ * or the whole segment if it is shorter. The segment is mapped again (the old
+ * mapping lives on in the pages that use it) only when it has grown past the
+ * current mapping.
  *
- * @param pageName 
- * @return true 
- * @return false 
+ * @param segment 
+ * @param length 
+ * @return shared_ptr<const SegmentMapping> nullptr if the segment is empty or
+ * cannot be mapped
  */
-bool BufferManager::inPool(string pageName)
+shared_ptr<const SegmentMapping> BufferManager::mapSegment(Segment &segment, size_t length)
 {
-    logger.log("BufferManager::inPool");
-    for (auto page : this->pages)
+    if (segment.mapping && segment.mapping->length >= length)
+        return segment.mapping;
+    struct stat segmentStatus;
+    if (fstat(segment.fd, &segmentStatus) < 0 || segmentStatus.st_size == 0)
+        return segment.mapping;
+    if (segment.mapping && segment.mapping->length >= (size_t)segmentStatus.st_size)
+        return segment.mapping;
+    logger.log("BufferManager::mapSegment");
+    void *address = mmap(nullptr, segmentStatus.st_size, PROT_READ, MAP_SHARED, segment.fd, 0);
+    if (address == MAP_FAILED)
     {
-        if (pageName == page.pageName)
-            return true;
+        logger.log("BufferManager::mapSegment: Err");
+        return segment.mapping;
     }
-    return false;
+    segment.mapping = make_shared<SegmentMapping>((const char *)address, (size_t)segmentStatus.st_size);
+    return segment.mapping;
 }
 
 /**
- * @brief If the page is present in the pool, then this function returns the
- * page. Note that this function will fail if the page is not present in the
- * pool.
+ * @brief Asks the read-ahead worker for pages firstPageIndex onwards, at most
+ * pageCount of them and none past the end of the segment. Pages already in
+ * the pool or already asked for are skipped.
  *
- * @param pageName 
- * @return Page 
+ * @param tableName 
+ * @param firstPageIndex 
+ * @param pageCount 
  */
-Page BufferManager::getFromPool(string pageName)
+void BufferManager::prefetch(string tableName, int firstPageIndex, int pageCount)
 {
-    logger.log("BufferManager::getFromPool");
-    for (auto page : this->pages)
-        if (pageName == page.pageName)
-            return page;
+    Segment &segment = this->openSegment(tableName);
+    if (this->mappedReads)
+    {
+        // The kernel reads the mapped range ahead by itself
+        static const size_t systemPageSize = sysconf(_SC_PAGESIZE);
+        shared_ptr<const SegmentMapping> mapping = this->mapSegment(segment, (size_t)(firstPageIndex + pageCount) * Page::pageSize());
+        size_t start = (size_t)firstPageIndex * Page::pageSize() / systemPageSize * systemPageSize;
+        if (!mapping || start >= mapping->length)
+            return;
+        size_t end = min((size_t)(firstPageIndex + pageCount) * Page::pageSize(), mapping->length);
+        madvise((void *)(mapping->address + start), end - start, MADV_WILLNEED);
+        return;
+    }
+    struct stat segmentStatus;
+    if (fstat(segment.fd, &segmentStatus) < 0)
+        return;
+    int segmentPages = (segmentStatus.st_size + Page::pageSize() - 1) / Page::pageSize();
+    int lastPageIndex = min(firstPageIndex + pageCount, segmentPages);
+    for (int pageIndex = firstPageIndex; pageIndex < lastPageIndex; pageIndex++)
+    {
+        uint64_t pageKey = ((uint64_t)segment.tableId << 32) | (uint32_t)pageIndex;
+        if (this->frames.count(pageKey) || this->prefetcher.isStaged(pageKey))
+            continue;
+        this->prefetcher.request({pageKey, tableName, pageIndex, segment.fd});
+    }
 }
 
 /**
- * @brief Inserts page indicated by tableName and pageIndex into pool. If the
- * pool is full, the pool ejects the oldest inserted page from the pool and adds
- * the current page at the end. It naturally follows a queue data structure. 
+ * @brief Builds the frame table key of a page from the id of its table and the
+ * page index.
  *
  * @param tableName 
  * @param pageIndex 
- * @return Page 
+ * @return uint64_t 
  */
-Page BufferManager::insertIntoPool(string tableName, int pageIndex)
+uint64_t BufferManager::getPageKey(string tableName, int pageIndex)
+{
+    return ((uint64_t)this->openSegment(tableName).tableId << 32) | (uint32_t)pageIndex;
+}
+
+/**
+ * @brief Inserts a page that was just read into the pool. If the pool is full,
+ * the replacement policy picks an unpinned page to eject from the pool first.
+ *
+ * @param pageKey 
+ * @param page 
+ * @return PageHandle 
+ */
+PageHandle BufferManager::insertIntoPool(uint64_t pageKey, PageHandle page)
 {
     logger.log("BufferManager::insertIntoPool");
-    Page page(tableName, pageIndex);
-    if (this->pages.size() >= BLOCK_COUNT)
-        pages.pop_front();
-    pages.push_back(page);
+    while (this->frames.size() >= BLOCK_COUNT)
+        if (!this->evictFrame())
+            break;
+    this->frames[pageKey] = page;
+    this->policy->recordInsert(pageKey);
     return page;
 }
 
+/**
+ * @brief Evicts the frame chosen by the replacement policy among the frames
+ * that are not pinned by a handle, writing it back first if it is dirty. If
+ * every frame is pinned the pool is allowed to grow past BLOCK_COUNT until
+ * handles are released.
+ *
+ * @return true if a frame was evicted
+ * @return false if every frame is pinned
+ */
+bool BufferManager::evictFrame()
+{
+    uint64_t victim;
+    auto isEvictable = [&](uint64_t pageKey) {
+        auto frame = this->frames.find(pageKey);
+        return frame != this->frames.end() && frame->second.use_count() == 1;
+    };
+    if (!this->policy->pickVictim(isEvictable, victim))
+    {
+        logger.log("BufferManager::evictFrame: all frames pinned");
+        return false;
+    }
+    auto frame = this->frames.find(victim);
+    this->writeBack(frame->second);
+    this->frames.erase(frame);
+    return true;
+}
+
+/**
+ * @brief Writes a dirty page back to its slot in the segment file. Clean
+ * pages are left alone.
+ *
+ * @param page 
+ */
+void BufferManager::writeBack(PageHandle page)
+{
+    if (!page->isDirty())
+        return;
+    logger.log("BufferManager::writeBack");
+    page->writePage();
+    this->statistics[this->policy->getName()].writeBacks++;
+}
+
+/**
+ * @brief Checkpoint for one table: every dirty frame of the table is written
+ * back. The frames stay in the pool, now clean.
+ *
+ * @param tableName 
+ */
+void BufferManager::flush(string tableName)
+{
+    logger.log("BufferManager::flush");
+    auto segment = this->segments.find(tableName);
+    if (segment == this->segments.end())
+        return;
+    uint tableId = segment->second.tableId;
+    for (auto &frame : this->frames)
+        if ((frame.first >> 32) == tableId)
+            this->writeBack(frame.second);
+}
+
+/**
+ * @brief Drops any cached or read-ahead copy of pages that were written to
+ * the segment directly (see Table::blockify), without writing them back.
+ *
+ * @param tableName 
+ * @param firstPageIndex 
+ * @param pageCount 
+ */
+void BufferManager::forgetPages(string tableName, int firstPageIndex, int pageCount)
+{
+    logger.log("BufferManager::forgetPages");
+    for (int pageIndex = firstPageIndex; pageIndex < firstPageIndex + pageCount; pageIndex++)
+        this->dropFrame(this->getPageKey(tableName, pageIndex));
+}
+
+/**
+ * @brief Checkpoint for the whole pool: every dirty frame is written back.
+ */
+void BufferManager::flushPool()
+{
+    logger.log("BufferManager::flushPool");
+    for (auto &frame : this->frames)
+        this->writeBack(frame.second);
+}
+
+/**
+ * @brief Removes a frame from the pool without writing it back, along with
+ * any copy read ahead. Handles to the page that are still held elsewhere stay
+ * valid.
+ *
+ * @param pageKey 
+ */
+void BufferManager::dropFrame(uint64_t pageKey)
+{
+    this->prefetcher.discard(pageKey);
+    auto frame = this->frames.find(pageKey);
+    if (frame == this->frames.end())
+        return;
+    this->policy->recordRemove(pageKey);
+    this->frames.erase(frame);
+}
+
 /**
  * @brief The buffer manager is also responsible for writing pages. This is
- * called when new tables are created using assignment statements.
+ * called when new tables are created using assignment statements. The page
+ * is written through at once and any cached copy of it is discarded.
  *
  * @param tableName 
  * @param pageIndex 
  * @param rows 
  * @param rowCount 
+ * @param layout 
  */
-void BufferManager::writePage(string tableName, int pageIndex, vector<vector<int>> rows, int rowCount)
+void BufferManager::writePage(string tableName, int pageIndex, vector<vector<int>> rows, int rowCount, PageLayout layout)
 {
     logger.log("BufferManager::writePage");
-    Page page(tableName, pageIndex, rows, rowCount);
+    Page page(tableName, pageIndex, rows, rowCount, layout);
     page.writePage();
+    this->dropFrame(this->getPageKey(tableName, pageIndex));
 }
 
 /**
@@ -106,8 +280,9 @@ void BufferManager::deleteFile(string fileName)
 }
 
 /**
- * @brief Overloaded function that calls deleteFile(fileName) by constructing
- * the fileName from the tableName and pageIndex.
+ * @brief Pages no longer have files of their own, so deleting a single page
+ * only drops it from the pool. The storage is reclaimed when the whole
+ * segment is deleted.
  *
  * @param tableName 
  * @param pageIndex 
@@ -115,16 +290,161 @@ void BufferManager::deleteFile(string fileName)
 void BufferManager::deleteFile(string tableName, int pageIndex)
 {
     logger.log("BufferManager::deleteFile");
-    string fileName = "../data/temp/"+tableName + "_Page" + to_string(pageIndex);
-    this->deleteFile(fileName);
+    this->dropFrame(this->getPageKey(tableName, pageIndex));
+}
+
+/**
+ * @brief Name of the segment file that holds every block of the table.
+ *
+ * @param tableName 
+ * @return string 
+ */
+string BufferManager::getSegmentName(string tableName)
+{
+    return "../data/temp/" + tableName + "_Segment";
 }
 
 /**
- * @brief Clears the pool of table.
+ * @brief Returns the descriptor of the table's segment file, opening (and if
+ * needed creating) it on first use. Descriptors stay open until the segment
+ * is deleted so page faults do not pay for an open/close.
+ *
+ * @param tableName 
+ * @return int 
+ */
+int BufferManager::getSegment(string tableName)
+{
+    return this->openSegment(tableName).fd;
+}
+
+/**
+ * @brief Looks up the open segment of a table, opening the file and giving
+ * the table a fresh id the first time it is touched.
+ *
+ * @param tableName 
+ * @return Segment& 
+ */
+Segment &BufferManager::openSegment(string tableName)
+{
+    auto segment = this->segments.find(tableName);
+    if (segment != this->segments.end())
+        return segment->second;
+    logger.log("BufferManager::openSegment");
+    Segment opened;
+    opened.fd = open(this->getSegmentName(tableName).c_str(), O_RDWR | O_CREAT, 0644);
+    opened.tableId = this->nextTableId++;
+    if (opened.fd < 0)
+        logger.log("BufferManager::openSegment: Err");
+    return this->segments[tableName] = opened;
+}
+
+/**
+ * @brief Drops every page of the table from the pool, closes its segment and
+ * removes the segment file (and its side header) from disk.
+ *
+ * @param tableName 
+ */
+void BufferManager::deleteSegment(string tableName)
+{
+    logger.log("BufferManager::deleteSegment");
+    auto segment = this->segments.find(tableName);
+    if (segment != this->segments.end())
+    {
+        uint tableId = segment->second.tableId;
+        this->prefetcher.discardTable(tableId);
+        vector<uint64_t> tablePages;
+        for (auto &frame : this->frames)
+            if ((frame.first >> 32) == tableId)
+                tablePages.push_back(frame.first);
+        for (uint64_t pageKey : tablePages)
+            this->dropFrame(pageKey);
+        // Pages still held elsewhere keep their mapping alive
+        segment->second.mapping.reset();
+        close(segment->second.fd);
+        this->segments.erase(segment);
+    }
+    this->deleteFile(this->getSegmentName(tableName));
+    this->deleteFile(this->getSegmentName(tableName) + ".header");
+}
+
+/**
+ * @brief Clears the pool of table. Dirty frames are written back first and
+ * pages read ahead are forgotten.
  */
 void BufferManager::clearPool()
 {
   // cout << "DEBUG: Clearing Buffer Pool" << endl;
+  this->flushPool();
+  this->prefetcher.discardAll();
   // Clear all pages from the pool
-  this->pages.clear();
+  for (auto &frame : this->frames)
+    this->policy->recordRemove(frame.first);
+  this->frames.clear();
+}
+
+/**
+ * @brief Switches the replacement policy. The pool is emptied so the new
+ * policy starts from a cold pool; statistics of earlier policies are kept.
+ *
+ * @param policyName 
+ * @return true if policyName names a known policy
+ * @return false otherwise
+ */
+bool BufferManager::setPolicy(string policyName)
+{
+    logger.log("BufferManager::setPolicy");
+    ReplacementPolicy *policy = createReplacementPolicy(policyName);
+    if (!policy)
+        return false;
+    this->clearPool();
+    this->policy.reset(policy);
+    return true;
+}
+
+string BufferManager::getPolicyName()
+{
+    return this->policy->getName();
+}
+
+/**
+ * @brief Chooses how pages are read from their segments: PREAD copies each
+ * page into its frame, MMAP maps the segments and reads pages in place. The
+ * pool is emptied so no frame is left over from the other read path.
+ *
+ * @param readPathName 
+ * @return true if readPathName is PREAD or MMAP
+ * @return false otherwise
+ */
+bool BufferManager::setReadPath(string readPathName)
+{
+    logger.log("BufferManager::setReadPath");
+    if (readPathName != "PREAD" && readPathName != "MMAP")
+        return false;
+    this->clearPool();
+    this->mappedReads = (readPathName == "MMAP");
+    return true;
+}
+
+/**
+ * @brief Prints the hit and miss counters collected under every policy that
+ * has been in use. The current policy is marked with a '*'.
+ */
+void BufferManager::printStatistics()
+{
+    logger.log("BufferManager::printStatistics");
+    cout << "POLICY HITS MISSES HIT_RATIO WRITE_BACKS PREFETCHED" << endl;
+    for (auto &policyStatistics : this->statistics)
+    {
+        BufferStatistics &counters = policyStatistics.second;
+        long long accesses = counters.hits + counters.misses;
+        cout << (policyStatistics.first == this->getPolicyName() ? "*" : "") << policyStatistics.first
+             << " " << counters.hits << " " << counters.misses << " "
+             << fixed << setprecision(4) << (accesses ? (double)counters.hits / accesses : 0.0)
+             << " " << counters.writeBacks << " " << counters.prefetched << endl;
+        cout.unsetf(ios::floatfield);
+    }
+    int dirtyFrames = 0;
+    for (auto &frame : this->frames)
+        dirtyFrames += frame.second->isDirty();
+    cout << "Pool: " << this->frames.size() << "/" << BLOCK_COUNT << " frames, " << dirtyFrames << " dirty" << endl;
 }
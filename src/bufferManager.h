@@ -1,39 +1,105 @@
-#include"page.h"
+#include"prefetcher.h"
 
 /**
  * @brief The BufferManager is responsible for reading pages to the main memory.
  * Recall that large files are broken and stored as blocks in the hard disk. The
  * minimum amount of memory that can be read from the disk is a block whose size
- * is indicated by BLOCK_SIZE. within this system we simulate blocks by
- * splitting and storing the file as multiple files each of one BLOCK_SIZE,
- * although this isn't traditionally how it's done. You can alternatively just
- * random access to the point where a block begins within the same
- * file. In this system we assume that the the sizes of blocks and pages are the
- * same. 
+ * is indicated by BLOCK_SIZE. All blocks of a table live in one segment file
+ * and block i is found by random access at offset i * Page::pageSize(), so a
+ * page fault is a single pread on a descriptor the buffer manager keeps open
+ * for the lifetime of the table. In this system we assume that the the sizes
+ * of blocks and pages are the same. 
  * 
  * <p>
- * The buffer can hold multiple pages quantified by BLOCK_COUNT. The
- * buffer manager follows the FIFO replacement policy i.e. the first block to be
- * read in is replaced by the new incoming block. This replacement policy should
- * be transparent to the executors i.e. the executor should not know if a block
- * was previously present in the buffer or was read in from the disk. 
+ * The buffer can hold multiple pages quantified by BLOCK_COUNT. Which block is
+ * replaced by a new incoming block is decided by a pluggable ReplacementPolicy
+ * (FIFO by default, or LRU, CLOCK, LRU-K and 2Q), chosen with SET BUFFER POLICY
+ * or the --buffer-policy startup flag. This replacement policy should be
+ * transparent to the executors i.e. the executor should not know if a block
+ * was previously present in the buffer or was read in from the disk. Hits and
+ * misses are counted per policy so policies can be compared on a workload.
+ * </p>
+ * <p>
+ * Frames are found through a hash table keyed by (table id, page index), so a
+ * lookup costs the same whether the pool holds ten pages or ten thousand.
+ * Pages are handed out as PageHandles that share the frame instead of copying
+ * it; a frame with outstanding handles is pinned and is never chosen for
+ * eviction.
+ * </p>
+ * <p>
+ * Frames are mutable. Executors change a page through its handle and the page
+ * marks itself dirty; the buffer manager writes a dirty frame back to its
+ * segment when the frame is evicted or at a checkpoint (flush), so many
+ * changes to one page cost a single page write. Writing or deleting a whole
+ * page or segment replaces the frame's contents and discards it unwritten.
+ * </p>
+ * <p>
+ * Cursors that walk a table page after page ask for the next PREFETCH_DEPTH
+ * pages to be read ahead (see Prefetcher). A miss on a page that was read
+ * ahead takes the staged copy instead of going to disk and is counted as
+ * PREFETCHED.
+ * </p>
+ * <p>
+ * With the MMAP read path (--read-path MMAP) a segment is mapped into memory
+ * instead, and a page fault builds a Page that reads its values straight out
+ * of the mapping, so the OS page cache acts as a second level buffer and a
+ * warm re-scan copies nothing. The mapping is extended when the segment grows
+ * past it; read-ahead becomes an madvise on the mapped range. Writes still go
+ * through pwrite, which the shared mapping sees at once.
  * </p>
  *
  */
+typedef shared_ptr<Page> PageHandle;
+
+struct Segment{
+    int fd;
+    uint tableId;
+    shared_ptr<const SegmentMapping> mapping;
+};
+
+struct BufferStatistics{
+    long long hits = 0;
+    long long misses = 0;
+    long long writeBacks = 0;
+    long long prefetched = 0;
+};
+
 class BufferManager{
 
-    deque<Page> pages; 
-    bool inPool(string pageName);
-    Page getFromPool(string pageName);
-    Page insertIntoPool(string tableName, int pageIndex);
+    unordered_map<uint64_t, PageHandle> frames;
+    unordered_map<string, Segment> segments;
+    uint nextTableId = 0;
+    unique_ptr<ReplacementPolicy> policy;
+    map<string, BufferStatistics> statistics;
+    Prefetcher prefetcher;
+    bool mappedReads = false;
+
+    Segment &openSegment(string tableName);
+    uint64_t getPageKey(string tableName, int pageIndex);
+    PageHandle insertIntoPool(uint64_t pageKey, PageHandle page);
+    bool evictFrame();
+    void dropFrame(uint64_t pageKey);
+    void writeBack(PageHandle page);
+    shared_ptr<const SegmentMapping> mapSegment(Segment &segment, size_t length);
 
     public:
     
     BufferManager();
-    Page getPage(string tableName, int pageIndex);
+    PageHandle getPage(string tableName, int pageIndex);
+    void prefetch(string tableName, int firstPageIndex, int pageCount);
     void writePage(string pageName, vector<vector<int>> rows);
     void deleteFile(string tableName, int pageIndex);
     void deleteFile(string fileName);
-    void writePage(string tableName, int pageIndex, vector<vector<int>> rows, int rowCount);
+    void writePage(string tableName, int pageIndex, vector<vector<int>> rows, int rowCount, PageLayout layout = ROW_MAJOR);
+    void flush(string tableName);
+    void forgetPages(string tableName, int firstPageIndex, int pageCount);
+    void flushPool();
     void clearPool();
+    string getSegmentName(string tableName);
+    int getSegment(string tableName);
+    void deleteSegment(string tableName);
+    bool setPolicy(string policyName);
+    string getPolicyName();
+    bool setReadPath(string readPathName);
+    void printStatistics();
 };
\ No newline at end of file
@@ -9,6 +9,11 @@ Cursor::Cursor(string tableName, int pageIndex)
     this->pageIndex = pageIndex;
 }
 
+Cursor::Cursor(string tableName, int pageIndex, vector<int> columnIndices) : Cursor(tableName, pageIndex)
+{
+    this->columnIndices = columnIndices;
+}
+
 /**
  * @brief This function reads the next row from the page. The index of the
  * current row read from the page is indicated by the pagePointer(points to row
@@ -18,19 +23,138 @@ Cursor::Cursor(string tableName, int pageIndex)
  */
 vector<int> Cursor::getNext()
 {
-  vector<int> result = this->page.getRow(this->pagePointer);
-  this->pagePointer++;
-  if (result.empty())
+  span<const int> row = this->getNextView();
+  return vector<int>(row.begin(), row.end());
+}
+
+/**
+ * @brief Same as getNext but returns a view of the row instead of a copy.
+ * When the current page is exhausted the cursor moves on to the next page of
+ * the table; an empty view means all rows have been read.
+ *
+ * @return span<const int> 
+ */
+span<const int> Cursor::getNextView()
+{
+  while (this->pagePointer >= this->page->getNumRecords())
+    if (!this->advancePage())
+      return span<const int>();
+  return this->readRow(this->pagePointer++, this->columnIndices, this->rowBuffer);
+}
+
+/**
+ * @brief Moves the cursor to the next page of the table, if there is one.
+ *
+ * @return true if the cursor moved
+ * @return false if the cursor is on the last page
+ */
+bool Cursor::advancePage()
+{
+  if (!this->table)
+    this->table = tableCatalogue.getTable(this->tableName);
+  int previousPageIndex = this->pageIndex;
+  this->table->getNextPage(this);
+  return this->pageIndex != previousPageIndex;
+}
+
+/**
+ * @brief Reads the next BATCH_SIZE rows of the cursor's columns (all columns
+ * if it has none) into batch. Columns of a PAX page are copied minipage slice
+ * by minipage slice; a row-major page is gathered column by column.
+ *
+ * @param batch 
+ * @return true if the batch holds at least one row
+ * @return false if all rows have been read
+ */
+bool Cursor::nextBatch(RowBatch &batch)
+{
+  if (!this->table)
+    this->table = tableCatalogue.getTable(this->tableName);
+  batch.columnCount = this->columnIndices.empty() ? this->table->columnCount : this->columnIndices.size();
+  batch.values.resize((size_t)batch.columnCount * BATCH_SIZE);
+  batch.rowCount = 0;
+  while (batch.rowCount < BATCH_SIZE)
   {
-    tableCatalogue.getTable(this->tableName)->getNextPage(this);
-    if (!this->pagePointer)
+    if (this->pagePointer >= this->page->getNumRecords())
+    {
+      if (!this->advancePage())
+        break;
+      continue;
+    }
+    int rowsTaken = min(BATCH_SIZE - batch.rowCount, this->page->getNumRecords() - this->pagePointer);
+    for (int columnCounter = 0; columnCounter < batch.columnCount; columnCounter++)
     {
-      result = this->page.getRow(this->pagePointer);
-      this->pagePointer++;
+      int columnIndex = this->columnIndices.empty() ? columnCounter : this->columnIndices[columnCounter];
+      int *destination = batch.values.data() + (size_t)columnCounter * BATCH_SIZE + batch.rowCount;
+      if (this->page->getLayout() == PAX)
+      {
+        span<const int> minipage = this->page->getColumnView(columnIndex);
+        copy(minipage.begin() + this->pagePointer, minipage.begin() + this->pagePointer + rowsTaken, destination);
+      }
+      else
+        for (int rowCounter = 0; rowCounter < rowsTaken; rowCounter++)
+          destination[rowCounter] = this->page->getValue(this->pagePointer + rowCounter, columnIndex);
     }
+    this->pagePointer += rowsTaken;
+    batch.rowCount += rowsTaken;
   }
-  return result;
+  return batch.rowCount > 0;
 }
+
+/**
+ * @brief Reads the given columns (all columns if the list is empty) of a row
+ * of the current page. Whole rows of a row-major page are viewed in place,
+ * anything else is gathered into buffer first.
+ *
+ * @param rowIndex 
+ * @param columns 
+ * @param buffer 
+ * @return span<const int> 
+ */
+span<const int> Cursor::readRow(int rowIndex, const vector<int> &columns, vector<int> &buffer)
+{
+  if (columns.empty() && this->page->getLayout() == ROW_MAJOR)
+    return this->page->getRowView(rowIndex);
+  buffer.resize(columns.empty() ? this->page->getColumnCount() : columns.size());
+  this->page->copyRow(rowIndex, columns, buffer.data());
+  return span<const int>(buffer);
+}
+
+/**
+ * @brief Returns every column of the row last returned by getNext, e.g. to
+ * emit a row that matched a predicate evaluated on a projection.
+ *
+ * @return vector<int> 
+ */
+vector<int> Cursor::getCurrentRow()
+{
+  span<const int> row = this->getCurrentRowView();
+  return vector<int>(row.begin(), row.end());
+}
+
+/**
+ * @brief View of every column of the row last returned by getNext.
+ *
+ * @return span<const int> 
+ */
+span<const int> Cursor::getCurrentRowView()
+{
+  return this->readRow(this->pagePointer - 1, {}, this->currentRowBuffer);
+}
+
+/**
+ * @brief Makes the cursor pass over the pages pageFilter rejects. If the
+ * cursor's current page is one of them, its rows are skipped too.
+ *
+ * @param pageFilter 
+ */
+void Cursor::setPageFilter(function<bool(int)> pageFilter)
+{
+    this->pageFilter = pageFilter;
+    if (this->pagePointer == 0 && !this->pageFilter(this->pageIndex))
+        this->pagePointer = this->page->getNumRecords();
+}
+
 /**
  * @brief Function that loads Page indicated by pageIndex. Now the cursor starts
  * reading from the new page.
@@ -40,6 +164,8 @@ vector<int> Cursor::getNext()
 void Cursor::nextPage(int pageIndex)
 {
     logger.log("Cursor::nextPage");
+    if (pageIndex == this->pageIndex + 1 && PREFETCH_DEPTH)
+        bufferManager.prefetch(this->tableName, pageIndex + 1, PREFETCH_DEPTH);
     this->page = bufferManager.getPage(this->tableName, pageIndex);
     this->pageIndex = pageIndex;
     this->pagePointer = 0;
@@ -1,19 +1,88 @@
 #include"bufferManager.h"
+
+class Table;
+
+/**
+ * @brief A batch of up to BATCH_SIZE rows handed out by Cursor::nextBatch. The
+ * values are stored column-major, each column in its own fixed slot of the
+ * buffer, so an operator can run a tight loop over one column of the batch.
+ */
+const int BATCH_SIZE = 1024;
+
+struct RowBatch{
+    int rowCount = 0;
+    int columnCount = 0;
+    vector<int> values;
+
+    span<const int> getColumn(int columnIndex) const
+    {
+        return span<const int>(values.data() + (size_t)columnIndex * BATCH_SIZE, rowCount);
+    }
+    int getValue(int rowIndex, int columnIndex) const
+    {
+        return values[(size_t)columnIndex * BATCH_SIZE + rowIndex];
+    }
+    void copyRow(int rowIndex, int *destination) const
+    {
+        for (int columnCounter = 0; columnCounter < columnCount; columnCounter++)
+            destination[columnCounter] = getValue(rowIndex, columnCounter);
+    }
+};
+
 /**
  * @brief The cursor is an important component of the system. To read from a
  * table, you need to initialize a cursor. The cursor reads rows from a page one
- * at a time.
+ * at a time. A cursor created with a list of column indices is a projection
+ * cursor: getNext returns only those columns, and getCurrentRow can still
+ * fetch the whole row the cursor is on.
  *
+ * <p>
+ * getNextView and getCurrentRowView return non-owning views instead of
+ * copies, so a scan does not allocate per row. A view points into the page
+ * (whole rows of a row-major page) or into a buffer owned by the cursor
+ * (projections and PAX pages) and is valid until the cursor moves again.
+ * </p>
+ * <p>
+ * nextBatch reads the next BATCH_SIZE rows (fewer at the end of the table) of
+ * the cursor's columns into a RowBatch, crossing page boundaries as needed.
+ * The table is looked up in the catalogue once per cursor, not once per page.
+ * </p>
+ * <p>
+ * Whenever a cursor moves from a page to the one right after it, the scan is
+ * taken to be sequential and the buffer manager is asked to read the next
+ * PREFETCH_DEPTH pages ahead in the background.
+ * </p>
+ * <p>
+ * A cursor can be given a page filter (typically a zone map filter, see
+ * getZoneFilter): pages the filter rejects are passed over without being
+ * read.
+ * </p>
  */
 class Cursor{
     public:
-    Page page;
+    PageHandle page;
     int pageIndex;
     string tableName;
     int pagePointer;
+    vector<int> columnIndices;
+    function<bool(int)> pageFilter;
+
+    private:
+    Table *table = nullptr;
+    vector<int> rowBuffer;
+    vector<int> currentRowBuffer;
+
+    span<const int> readRow(int rowIndex, const vector<int> &columns, vector<int> &buffer);
+    bool advancePage();
 
     public:
     Cursor(string tableName, int pageIndex);
+    Cursor(string tableName, int pageIndex, vector<int> columnIndices);
     vector<int> getNext();
+    span<const int> getNextView();
+    vector<int> getCurrentRow();
+    span<const int> getCurrentRowView();
+    bool nextBatch(RowBatch &batch);
     void nextPage(int pageIndex);
+    void setPageFilter(function<bool(int)> pageFilter);
 };
\ No newline at end of file
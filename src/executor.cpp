@@ -29,6 +29,9 @@ void executeCommand(){
         case DELETE: executeDELETE(); break;
         case INSERT: executeINSERT(); break;
         case UPDATE: executeUPDATE(); break;
+        case SET_BUFFER_POLICY: executeSETBUFFERPOLICY(); break;
+        case PRINT_BUFFER: executePRINTBUFFER(); break;
+        case ANALYZE: executeANALYZE(); break;
         default: cout<<"PARSING ERROR"<<endl;
     }
 
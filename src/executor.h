@@ -1,4 +1,4 @@
-#include "semanticParser.h"
+#include "predicate.h"
 
 void executeCommand();
 
@@ -31,4 +31,7 @@ void printRowCount(int rowCount);
 void executeSEARCH();
 void executeDELETE();
 void executeINSERT();
-void executeUPDATE();
\ No newline at end of file
+void executeUPDATE();
+void executeSETBUFFERPOLICY();
+void executePRINTBUFFER();
+void executeANALYZE();
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "global.h"
+/**
+ * @brief 
+ * SYNTAX: ANALYZE relation_name
+ *
+ * Recomputes the column statistics of the relation (row count, estimated
+ * number of distinct values, min, max and equi-depth histogram) and prints
+ * them.
+ */
+bool syntacticParseANALYZE()
+{
+    logger.log("syntacticParseANALYZE");
+    if (tokenizedQuery.size() != 2)
+    {
+        cout << "SYNTAX ERROR" << endl;
+        return false;
+    }
+    parsedQuery.queryType = ANALYZE;
+    parsedQuery.analyzeRelationName = tokenizedQuery[1];
+    return true;
+}
+
+bool semanticParseANALYZE()
+{
+    logger.log("semanticParseANALYZE");
+    if (!tableCatalogue.isTable(parsedQuery.analyzeRelationName))
+    {
+        cout << "SEMANTIC ERROR: Relation doesn't exist" << endl;
+        return false;
+    }
+    return true;
+}
+
+void executeANALYZE()
+{
+    logger.log("executeANALYZE");
+    Table *table = tableCatalogue.getTable(parsedQuery.analyzeRelationName);
+    table->analyze();
+    cout << "Row Count: " << table->rowCount << endl;
+    cout << "COLUMN DISTINCT MIN MAX HISTOGRAM" << endl;
+    for (int columnCounter = 0; columnCounter < table->columnCount; columnCounter++)
+    {
+        ColumnStatistics &statistics = table->columnStatistics[columnCounter];
+        cout << table->columns[columnCounter] << " " << statistics.estimateDistinctCount() << " "
+             << statistics.minValue << " " << statistics.maxValue;
+        for (int bound : statistics.histogramBounds)
+            cout << " " << bound;
+        cout << endl;
+    }
+    return;
+}
@@ -37,67 +37,103 @@ bool semanticParseCROSS()
     return true;
 }
 
+/**
+ * @brief Block nested-loop cross product. The first relation is read in
+ * chunks of BLOCK_COUNT - 2 pages (one page is left for reading the second
+ * relation and one for the output) and the second relation is streamed once
+ * per chunk, pairing each of its rows with every row of the chunk. The
+ * second relation is therefore read pages(first) / (BLOCK_COUNT - 2) times
+ * rather than once per row of the first. Result rows come out grouped by
+ * chunk; they are collected into a page, which is written to the segment of
+ * the result as soon as it is full.
+ */
 void executeCROSS()
 {
     logger.log("executeCROSS");
 
-    Table table1 = *(tableCatalogue.getTable(parsedQuery.crossFirstRelationName));
-    Table table2 = *(tableCatalogue.getTable(parsedQuery.crossSecondRelationName));
+    Table *table1 = tableCatalogue.getTable(parsedQuery.crossFirstRelationName);
+    Table *table2 = tableCatalogue.getTable(parsedQuery.crossSecondRelationName);
 
     vector<string> columns;
 
     //If both tables are the same i.e. CROSS a a, then names are indexed as a1 and a2
-    if(table1.tableName == table2.tableName){
+    if(table1->tableName == table2->tableName){
         parsedQuery.crossFirstRelationName += "1";
         parsedQuery.crossSecondRelationName += "2";
     }
 
     //Creating list of column names
-    for (int columnCounter = 0; columnCounter < table1.columnCount; columnCounter++)
+    for (int columnCounter = 0; columnCounter < table1->columnCount; columnCounter++)
     {
-        string columnName = table1.columns[columnCounter];
-        if (table2.isColumn(columnName))
+        string columnName = table1->columns[columnCounter];
+        if (table2->isColumn(columnName))
         {
             columnName = parsedQuery.crossFirstRelationName + "_" + columnName;
         }
         columns.emplace_back(columnName);
     }
 
-    for (int columnCounter = 0; columnCounter < table2.columnCount; columnCounter++)
+    for (int columnCounter = 0; columnCounter < table2->columnCount; columnCounter++)
     {
-        string columnName = table2.columns[columnCounter];
-        if (table1.isColumn(columnName))
+        string columnName = table2->columns[columnCounter];
+        if (table1->isColumn(columnName))
         {
             columnName = parsedQuery.crossSecondRelationName + "_" + columnName;
         }
         columns.emplace_back(columnName);
     }
 
-    Table *resultantTable = new Table(parsedQuery.crossResultRelationName, columns);\
-
-    Cursor cursor1 = table1.getCursor();
-    Cursor cursor2 = table2.getCursor();
+    Table *resultantTable = new Table(parsedQuery.crossResultRelationName, columns);
 
-    vector<int> row1 = cursor1.getNext();
-    vector<int> row2;
-    vector<int> resultantRow;
-    resultantRow.reserve(resultantTable->columnCount);
-
-    while (!row1.empty())
+    vector<int> resultPage;
+    resultPage.reserve((size_t)resultantTable->maxRowsPerBlock * resultantTable->columnCount);
+    auto writeResultPage = [&]() {
+        int rowsInPage = resultPage.size() / resultantTable->columnCount;
+        Page(resultantTable->tableName, resultantTable->blockCount, resultPage, resultantTable->columnCount, resultantTable->layout).writePage();
+        resultantTable->rowsPerBlockCount.emplace_back(rowsInPage);
+        resultantTable->blockCount++;
+        resultPage.clear();
+    };
+    if (table1->rowCount > 0 && table2->rowCount > 0)
     {
-
-        cursor2 = table2.getCursor();
-        row2 = cursor2.getNext();
-        while (!row2.empty())
+        long long chunkRows = (long long)max(1, (int)BLOCK_COUNT - 2) * table1->maxRowsPerBlock;
+        Cursor cursor1 = table1->getCursor();
+        vector<int> chunk;
+        while (true)
         {
-            resultantRow = row1;
-            resultantRow.insert(resultantRow.end(), row2.begin(), row2.end());
-            resultantTable->writeRow<int>(resultantRow);
-            row2 = cursor2.getNext();
+            chunk.clear();
+            long long chunkRowCount = 0;
+            span<const int> row1;
+            while (chunkRowCount < chunkRows && !(row1 = cursor1.getNextView()).empty())
+            {
+                chunk.insert(chunk.end(), row1.begin(), row1.end());
+                chunkRowCount++;
+            }
+            if (chunkRowCount == 0)
+                break;
+
+            Cursor cursor2 = table2->getCursor();
+            for (span<const int> row2 = cursor2.getNextView(); !row2.empty(); row2 = cursor2.getNextView())
+            {
+                for (auto offset = chunk.begin(); offset != chunk.end(); offset += table1->columnCount)
+                {
+                    resultPage.insert(resultPage.end(), offset, offset + table1->columnCount);
+                    resultPage.insert(resultPage.end(), row2.begin(), row2.end());
+                    span<const int> resultantRow(resultPage.data() + resultPage.size() - resultantTable->columnCount, resultantTable->columnCount);
+                    resultantTable->updateStatistics(resultantRow);
+                    resultantTable->widenZoneMap(resultantTable->blockCount, resultantRow);
+                    if (resultPage.size() == (size_t)resultantTable->maxRowsPerBlock * resultantTable->columnCount)
+                        writeResultPage();
+                }
+            }
+            if (chunkRowCount < chunkRows)
+                break;
         }
-        row1 = cursor1.getNext();
     }
-    resultantTable->blockify();
+    if (!resultPage.empty())
+        writeResultPage();
+    bufferManager.forgetPages(resultantTable->tableName, 0, resultantTable->blockCount);
+    resultantTable->writeSegmentHeader();
     tableCatalogue.insertTable(resultantTable);
     // cout << "Tables crossed :) " << endl;
     return;
@@ -164,7 +164,20 @@ void executeDELETE()
   logger.log("DELETE: Finding records where " + columnName + " " + deleteOperator + " " + to_string(deleteValue));
   logger.log("DELETE: Keeping records where " + columnName + " " + negatedOperator + " " + to_string(deleteValue));
 
+  // If the zone maps rule out every block there is nothing to delete, and
+  // the table does not have to be rewritten
+  function<bool(int)> zoneFilter = getZoneFilter(sourceTable, columnIndex, parseBinaryOperator(deleteOperator), deleteValue);
+  bool anyBlockMayMatch = false;
+  for (int blockCounter = 0; blockCounter < sourceTable->blockCount && !anyBlockMayMatch; blockCounter++)
+    anyBlockMayMatch = zoneFilter(blockCounter);
+  if (!anyBlockMayMatch)
+  {
+    cout << "No rows matched the deletion condition." << endl;
+    return;
+  }
+
   // Check if secondary index exists for this column
+  SecondaryIndex::refreshIndexes(tableName);
   SecondaryIndex *indexObj = nullptr;
   string indexFileName = "../data/indices/" + tableName + "_" + columnName + "_Indexfile_0";
   bool indexExists = false;
@@ -214,14 +227,16 @@ void executeDELETE()
       bpFile >> recordCount;
 
       // Process each record pointer
+      vector<int> row;
       for (int i = 0; i < recordCount; i++)
       {
         int pageNo, recordNo;
         bpFile >> pageNo >> recordNo;
 
         // Get the actual row from the source table
-        Page page = bufferManager.getPage(tableName, pageNo);
-        vector<int> row = page.getRow(recordNo);
+        PageHandle page = bufferManager.getPage(tableName, pageNo);
+        row.resize(page->getColumnCount());
+        page->copyRow(recordNo, {}, row.data());
 
         // Add row to temporary table
         tempTable->writeRow<int>(row);
@@ -236,56 +251,30 @@ void executeDELETE()
   }
   else
   {
-    // Linear scan approach if no index is available
+    // Linear scan approach if no index is available. The negated predicate
+    // marks the rows of each batch that survive the delete
     Cursor cursor = sourceTable->getCursor();
-    vector<int> row = cursor.getNext();
+    RowBatch batch;
+    BinaryOperator keepOperator = parseBinaryOperator(negatedOperator);
+    uint64_t bitmap[BATCH_SIZE / 64];
+    vector<int> row(sourceTable->columnCount);
+    ofstream fout(tempTable->sourceFileName, ios::app);
 
-    while (!row.empty())
+    while (cursor.nextBatch(batch))
     {
-      // Check if this row should be kept (not deleted)
-      bool keepRow = false;
-
-      if (negatedOperator == "<")
-        keepRow = row[columnIndex] < deleteValue;
-      else if (negatedOperator == "<=")
-        keepRow = row[columnIndex] <= deleteValue;
-      else if (negatedOperator == ">")
-        keepRow = row[columnIndex] > deleteValue;
-      else if (negatedOperator == ">=")
-        keepRow = row[columnIndex] >= deleteValue;
-      else if (negatedOperator == "==")
-        keepRow = row[columnIndex] == deleteValue;
-      else if (negatedOperator == "!=")
-        keepRow = row[columnIndex] != deleteValue;
-
-      if (keepRow)
-      {
+      evaluatePredicate(batch.getColumn(columnIndex), keepOperator, deleteValue, bitmap);
+      int keptInBatch = 0;
+      forEachSelectedRow(bitmap, batch.rowCount, [&](int rowCounter) {
         // Add row to temporary table
-        tempTable->writeRow<int>(row);
-        recordsKept++;
-      }
-      else
-      {
-        recordsDeleted++;
-      }
-
-      // Get next row
-      row = cursor.getNext();
+        batch.copyRow(rowCounter, row.data());
+        tempTable->writeRow<int>(row, fout);
+        keptInBatch++;
+      });
+      recordsKept += keptInBatch;
+      recordsDeleted += batch.rowCount - keptInBatch;
     }
+    fout.close();
   }
-
-
-
-
-
-
-
-
-
-
-
-
-
   // Finalize the temporary table
   // Finalize the temp table
   tempTable->blockify();
@@ -300,13 +289,13 @@ void executeDELETE()
 
   // Copy data from temp table to new table
   Cursor tempCursor = tempTable->getCursor();
-  vector<int> tempRow;
+  span<const int> tempRow;
   while (true)
   {
-    tempRow = tempCursor.getNext();
+    tempRow = tempCursor.getNextView();
     if (tempRow.empty())
       break;
-    newTable->writeRow<int>(tempRow);
+    newTable->writeRow(tempRow);
   }
 
   // Finalize the new table
@@ -316,8 +305,14 @@ void executeDELETE()
   // Delete the temp table
   tableCatalogue.deleteTable(tempTableName);
 
-  SecondaryIndex newIndex(tableName, columnName);
-  newIndex.createIndex();
+  // The rows that are left have moved, so every index of the table is
+  // rebuilt; the column of the condition gets one if it had none
+  SecondaryIndex::rebuildIndexes(tableName);
+  if (!indexExists)
+  {
+    SecondaryIndex newIndex(tableName, columnName);
+    newIndex.createIndex();
+  }
 
   bufferManager.clearPool();
 
@@ -1,4 +1,5 @@
 #include "externalsort.h"
+#include "secondary_index.h"
 #include <ctime>
 #include <iomanip>
 #include <sstream>
@@ -7,7 +8,19 @@
 ExternalSort::ExternalSort(Table *table,
                            const vector<string> &sortColumns,
                            const vector<bool> &sortDirections)
-    : table(table), sortColumns(sortColumns), sortDirections(sortDirections) {}
+    : table(table), sortColumns(sortColumns), sortDirections(sortDirections)
+{
+  resolveSortColumns();
+}
+
+void ExternalSort::resolveSortColumns()
+{
+  sortColumnIndices.clear();
+  for (const string &sortColumn : sortColumns)
+  {
+    sortColumnIndices.push_back(table->getColumnIndex(sortColumn));
+  }
+}
 
 string ExternalSort::generateTempFileName(int runNumber)
 {
@@ -24,9 +37,9 @@ string ExternalSort::generateTempFileName(int runNumber)
 
 bool ExternalSort::compareRows(const vector<int> &a, const vector<int> &b)
 {
-  for (size_t i = 0; i < sortColumns.size(); ++i)
+  for (size_t i = 0; i < sortColumnIndices.size(); ++i)
   {
-    int colIndex = table->getColumnIndex(sortColumns[i]);
+    int colIndex = sortColumnIndices[i];
     if (a[colIndex] != b[colIndex])
     {
       return sortDirections[i] ? a[colIndex] < b[colIndex] : a[colIndex] > b[colIndex];
@@ -85,83 +98,16 @@ void ExternalSort::writeBlockToFile(ofstream &file, const vector<vector<int>> &b
   }
 }
 
-void ExternalSort::performExternalSort()
+/**
+ * @brief Merges sorted runs, EXTERNAL_SORT_BUFFER_BLOCKS - 1 at a time, until
+ * a single run is left in runFiles. The runs that were merged are deleted.
+ *
+ * @param runFiles
+ */
+void ExternalSort::mergeRuns(vector<string> &runFiles)
 {
-  // cout<<("ExternalSort::performExternalSort")<<endl;
-
-  // Vector to store temporary run files
-  vector<string> runFiles;
-
-  // Cursor to read original table
-  Cursor cursor = table->getCursor();
-
-  // Sorting Phase: Create sorted runs
-  int runNumber = 0;
-  vector<vector<int>> currentRun;
-
-  // Read and process rows
-  vector<int> row;
-  while (!(row = cursor.getNext()).empty())
-  {
-    currentRun.push_back(row);
-
-    // If run is full, sort and write to temporary file
-    if (currentRun.size() >= table->maxRowsPerBlock * EXTERNAL_SORT_BUFFER_BLOCKS)
-    {
-      // Sort the run
-      sortRun(currentRun);
-
-      // Write to temporary file
-      string tempFileName = generateTempFileName(runNumber++);
-      ofstream tempFile(tempFileName);
-
-      for (const auto &sortedRow : currentRun)
-      {
-        for (size_t j = 0; j < sortedRow.size(); ++j)
-        {
-          tempFile << sortedRow[j];
-          if (j < sortedRow.size() - 1)
-            tempFile << " ";
-        }
-        tempFile << "\n";
-      }
-      tempFile.close();
-
-      // Store the temporary file name
-      runFiles.push_back(tempFileName);
-
-      // Reset current run
-      currentRun.clear();
-    }
-  }
-
-  // Handle last run if not empty
-  if (!currentRun.empty())
-  {
-    // Sort the last run
-    sortRun(currentRun);
-
-    // Write to temporary file
-    string tempFileName = generateTempFileName(runNumber++);
-    ofstream tempFile(tempFileName);
-
-    for (const auto &sortedRow : currentRun)
-    {
-      for (size_t j = 0; j < sortedRow.size(); ++j)
-      {
-        tempFile << sortedRow[j];
-        if (j < sortedRow.size() - 1)
-          tempFile << " ";
-      }
-      tempFile << "\n";
-    }
-    tempFile.close();
-
-    // Store the temporary file name
-    runFiles.push_back(tempFileName);
-  }
-
-  // Merging Phase
+  // Merged runs are numbered after every run that may still exist
+  int runNumber = runFiles.size();
   while (runFiles.size() > 1)
   {
     vector<string> newRunFiles;
@@ -255,11 +201,12 @@ void ExternalSort::performExternalSort()
       mergedFile.close();
       newRunFiles.push_back(mergedRunFile);
 
-      // Close input files
+      // Close input files, which are no longer needed
       for (auto &file : inputFiles)
       {
         file.close();
       }
+      cleanupTempFiles(vector<string>(runFiles.begin() + i, runFiles.begin() + i + runsToMerge));
 
       // Move to next group of runs
       i += runsToMerge;
@@ -268,6 +215,86 @@ void ExternalSort::performExternalSort()
     // Replace old runs with new merged runs
     runFiles = newRunFiles;
   }
+}
+
+void ExternalSort::performExternalSort(bool printTable)
+{
+  // cout<<("ExternalSort::performExternalSort")<<endl;
+
+  // Vector to store temporary run files
+  vector<string> runFiles;
+
+  // Cursor to read original table
+  Cursor cursor = table->getCursor();
+
+  // Sorting Phase: Create sorted runs
+  int runNumber = 0;
+  vector<vector<int>> currentRun;
+
+  // Read and process rows
+  span<const int> row;
+  while (!(row = cursor.getNextView()).empty())
+  {
+    currentRun.emplace_back(row.begin(), row.end());
+
+    // If run is full, sort and write to temporary file
+    if (currentRun.size() >= table->maxRowsPerBlock * EXTERNAL_SORT_BUFFER_BLOCKS)
+    {
+      // Sort the run
+      sortRun(currentRun);
+
+      // Write to temporary file
+      string tempFileName = generateTempFileName(runNumber++);
+      ofstream tempFile(tempFileName);
+
+      for (const auto &sortedRow : currentRun)
+      {
+        for (size_t j = 0; j < sortedRow.size(); ++j)
+        {
+          tempFile << sortedRow[j];
+          if (j < sortedRow.size() - 1)
+            tempFile << " ";
+        }
+        tempFile << "\n";
+      }
+      tempFile.close();
+
+      // Store the temporary file name
+      runFiles.push_back(tempFileName);
+
+      // Reset current run
+      currentRun.clear();
+    }
+  }
+
+  // Handle last run if not empty
+  if (!currentRun.empty())
+  {
+    // Sort the last run
+    sortRun(currentRun);
+
+    // Write to temporary file
+    string tempFileName = generateTempFileName(runNumber++);
+    ofstream tempFile(tempFileName);
+
+    for (const auto &sortedRow : currentRun)
+    {
+      for (size_t j = 0; j < sortedRow.size(); ++j)
+      {
+        tempFile << sortedRow[j];
+        if (j < sortedRow.size() - 1)
+          tempFile << " ";
+      }
+      tempFile << "\n";
+    }
+    tempFile.close();
+
+    // Store the temporary file name
+    runFiles.push_back(tempFileName);
+  }
+
+  // Merging Phase
+  mergeRuns(runFiles);
 
   // Final step: Replace original table with sorted table
 
@@ -287,9 +314,7 @@ void ExternalSort::performExternalSort()
     // Reset table blocks and statistics
     table->blockCount = 0;
     table->rowsPerBlockCount.clear();
-    table->distinctValuesInColumns.assign(table->columnCount, unordered_set<int>());
-    table->distinctValuesPerColumnCount.assign(table->columnCount, 0);
-    table->rowCount = 0;
+    table->resetStatistics();
 
     // DEBUG: Add file content verification
     vector<vector<int>> debugFileContents;
@@ -321,11 +346,12 @@ void ExternalSort::performExternalSort()
 
       pageCounter++;
       table->updateStatistics(row);
+      table->widenZoneMap(table->blockCount, row);
 
       // When page is full, write page and reset
       if (pageCounter == table->maxRowsPerBlock)
       {
-        bufferManager.writePage(table->tableName, table->blockCount, rowsInPage, pageCounter);
+        bufferManager.writePage(table->tableName, table->blockCount, rowsInPage, pageCounter, table->layout);
         table->blockCount++;
         table->rowsPerBlockCount.emplace_back(pageCounter);
         pageCounter = 0;
@@ -336,7 +362,7 @@ void ExternalSort::performExternalSort()
     if (pageCounter > 0)
     {
       rowsInPage.resize(pageCounter);
-      bufferManager.writePage(table->tableName, table->blockCount, rowsInPage, pageCounter);
+      bufferManager.writePage(table->tableName, table->blockCount, rowsInPage, pageCounter, table->layout);
       table->blockCount++;
       table->rowsPerBlockCount.emplace_back(pageCounter);
     }
@@ -354,13 +380,21 @@ void ExternalSort::performExternalSort()
     //   cout<<(ss.str())<<endl;
     // }
 
+    table->writeSegmentHeader();
+    table->sortColumns = sortColumns;
+    table->sortDirections = sortDirections;
+
     // Clean up temporary files
     cleanupTempFiles(runFiles);
     bufferManager.clearPool();
+
+    // Every row moved, so the record pointers of the indices are now wrong
+    SecondaryIndex::rebuildIndexes(table->tableName);
   }
 
   // Print table to confirm sorting
-  table->print();
+  if (printTable)
+    table->print();
 }
 
 void ExternalSort::cleanupTempFiles(const vector<string> &tempFiles)
@@ -420,12 +454,12 @@ void ExternalSort::performOrderBy(const string &resultTableName,
   vector<vector<int>> currentRun;
 
   // Read and process rows
-  vector<int> row;
+  span<const int> row;
   int colIndex = table->getColumnIndex(sortColumn);
 
-  while (!(row = cursor.getNext()).empty())
+  while (!(row = cursor.getNextView()).empty())
   {
-    currentRun.push_back(row);
+    currentRun.emplace_back(row.begin(), row.end());
 
     // If run is full, sort and write to temporary file
     if (currentRun.size() >= table->maxRowsPerBlock * EXTERNAL_SORT_BUFFER_BLOCKS)
@@ -475,6 +509,12 @@ void ExternalSort::performOrderBy(const string &resultTableName,
     runFiles.push_back(tempFileName);
   }
 
+  // Merging Phase
+  this->sortColumns = sortColumns;
+  this->sortDirections = sortDirections;
+  resolveSortColumns();
+  mergeRuns(runFiles);
+
   // Final step: Write sorted data to the new table
   if (!runFiles.empty())
   {
@@ -483,9 +523,7 @@ void ExternalSort::performOrderBy(const string &resultTableName,
     // Reset result table blocks and statistics
     resultTable->blockCount = 0;
     resultTable->rowsPerBlockCount.clear();
-    resultTable->distinctValuesInColumns.assign(resultTable->columnCount, unordered_set<int>());
-    resultTable->distinctValuesPerColumnCount.assign(resultTable->columnCount, 0);
-    resultTable->rowCount = 0;
+    resultTable->resetStatistics();
 
     // Prepare to write sorted rows back to pages
     vector<vector<int>> currentPage;
@@ -522,6 +560,7 @@ void ExternalSort::performOrderBy(const string &resultTableName,
       // Add row to current page
       currentPage.push_back(row);
       resultTable->updateStatistics(row);
+      resultTable->widenZoneMap(resultTable->blockCount, row);
       pageCounter++;
 
       // When page is full, write page and reset
@@ -552,6 +591,10 @@ void ExternalSort::performOrderBy(const string &resultTableName,
 
     // cout << "[DEBUG] Finished writing pages. Total blocks: " << resultTable->blockCount << endl;
 
+    resultTable->writeSegmentHeader();
+    resultTable->sortColumns = sortColumns;
+    resultTable->sortDirections = sortDirections;
+
     // Clean up
     cleanupTempFiles(runFiles);
     bufferManager.clearPool();
@@ -22,6 +22,12 @@ private:
   // Sorting directions (true for ascending, false for descending)
   vector<bool> sortDirections;
 
+  // Indices of the sort columns, looked up once rather than per comparison
+  vector<int> sortColumnIndices;
+
+  // Look up the indices of the sort columns
+  void resolveSortColumns();
+
   // Generate a unique temporary filename
   string generateTempFileName(int runNumber);
 
@@ -45,8 +51,8 @@ public:
                const vector<string> &sortColumns,
                const vector<bool> &sortDirections);
 
-  // Main external sort method
-  void performExternalSort();
+  // Main external sort method; prints the sorted table unless told not to
+  void performExternalSort(bool printTable = true);
 
   void performOrderBy(const string &resultTableName,
                       const string &sortColumn,
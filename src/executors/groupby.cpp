@@ -2,11 +2,33 @@
 
 // enum QueryType { GROUPBY };
 
+/**
+ * @brief Splits an aggregate such as "AVG(Salary)" into the function and the
+ * attribute.
+ *
+ * @return true if the aggregate is well formed
+ * @return false otherwise
+ */
+static bool parseAggregate(const string &aggregate, string &aggregateFunc, string &attribute) {
+    size_t openParen = aggregate.find('(');
+    size_t closeParen = aggregate.find(')');
+    if (openParen == string::npos || closeParen == string::npos || closeParen <= openParen + 1 || closeParen != aggregate.size() - 1)
+        return false;
+    aggregateFunc = aggregate.substr(0, openParen);
+    attribute = aggregate.substr(openParen + 1, closeParen - openParen - 1);
+    return aggregateFunc == "SUM" || aggregateFunc == "COUNT" || aggregateFunc == "AVG" ||
+           aggregateFunc == "MAX" || aggregateFunc == "MIN";
+}
+
 /**
  * @brief
- * SYNTAX: Result <- GROUP BY <attribute1> FROM <table> 
- *         HAVING <Aggregate-Func1(attribute2)> <bin-op> <value> 
- *         RETURN <Aggregate-Func2(attribute3)>
+ * SYNTAX: Result <- GROUP BY <attribute1> [<attribute2> ...] FROM <table>
+ *         [HAVING <Aggregate-Func1(attribute)> <bin-op> <value>]
+ *         RETURN <Aggregate-Func2(attribute)> [<Aggregate-Func3(attribute)> ...]
+ *
+ * Grouping attributes and returned aggregates may also be separated by
+ * commas. The result has the grouping attributes followed by one column per
+ * returned aggregate.
  */
 
 bool syntacticParseGROUPBY() {
@@ -19,19 +41,20 @@ bool syntacticParseGROUPBY() {
     //  1: <- 
     //  2: GROUP
     //  3: BY
-    //  4: DepartmentID
+    //  4: DepartmentID (more grouping attributes may follow)
     //  5: FROM
     //  6: Groupby
-    //  7: HAVING
+    //  7: HAVING (optional, with the next three tokens)
     //  8: AVG(Salary)
     //  9: >
     // 10: 50000
     // 11: RETURN
-    // 12: MAX(Salary)
-    if (tokenizedQuery.size() != 13 || tokenizedQuery[1] != "<-" ||
+    // 12: MAX(Salary) (more aggregates may follow)
+    auto fromToken = find(tokenizedQuery.begin(), tokenizedQuery.end(), "FROM");
+    if (tokenizedQuery.size() < 8 || tokenizedQuery[1] != "<-" ||
         tokenizedQuery[2] != "GROUP" || tokenizedQuery[3] != "BY" ||
-        tokenizedQuery[5] != "FROM" || tokenizedQuery[7] != "HAVING" ||
-        tokenizedQuery[11] != "RETURN") 
+        fromToken == tokenizedQuery.end() || fromToken - tokenizedQuery.begin() < 5 ||
+        tokenizedQuery.end() - fromToken < 4) 
     {
         cout << "SYNTAX ERROR: Invalid GROUP BY query format." << endl;
         return false;
@@ -41,38 +64,45 @@ bool syntacticParseGROUPBY() {
 
     // Extract basic components
     parsedQuery.groupByResultRelationName = tokenizedQuery[0];  // Result table name
-    parsedQuery.groupByAttribute = tokenizedQuery[4];           // Attribute to group by
-    parsedQuery.groupByTableName = tokenizedQuery[6];           // Source table name
-
-    // Parse HAVING clause (token 8, 9, 10)
-    string havingClause = tokenizedQuery[8];  // e.g., "AVG(Salary)"
-    size_t openParen = havingClause.find('(');
-    size_t closeParen = havingClause.find(')');
-    if (openParen == string::npos || closeParen == string::npos || closeParen <= openParen + 1) {
-        cout << "SYNTAX ERROR: Invalid HAVING clause format." << endl;
-        return false;
-    }
-    parsedQuery.havingAggregateFunc = havingClause.substr(0, openParen);  // e.g., "AVG"
-    parsedQuery.havingAttribute = havingClause.substr(openParen + 1, closeParen - openParen - 1);  // e.g., "Salary"
-    
-    parsedQuery.havingOperator = tokenizedQuery[9];  // e.g., ">"
-    try {
-        parsedQuery.havingValue = stoi(tokenizedQuery[10]);  // e.g., 50000
-    } catch (invalid_argument &e) {
-        cout << "SYNTAX ERROR: Invalid HAVING value." << endl;
-        return false;
+    parsedQuery.groupByAttributes.assign(tokenizedQuery.begin() + 4, fromToken);  // Attributes to group by
+    parsedQuery.groupByTableName = *(fromToken + 1);            // Source table name
+
+    auto token = fromToken + 2;
+    if (*token == "HAVING") {
+        // Parse HAVING clause, e.g. "AVG(Salary) > 50000"
+        if (tokenizedQuery.end() - token < 5 ||
+            !parseAggregate(*(token + 1), parsedQuery.havingAggregateFunc, parsedQuery.havingAttribute)) {
+            cout << "SYNTAX ERROR: Invalid HAVING clause format." << endl;
+            return false;
+        }
+        parsedQuery.havingOperator = *(token + 2);  // e.g., ">"
+        if (parseBinaryOperator(parsedQuery.havingOperator) == NO_BINOP_CLAUSE) {
+            cout << "SYNTAX ERROR: Invalid HAVING operator." << endl;
+            return false;
+        }
+        try {
+            parsedQuery.havingValue = stoll(*(token + 3));  // e.g., 50000
+        } catch (logic_error &e) {
+            cout << "SYNTAX ERROR: Invalid HAVING value." << endl;
+            return false;
+        }
+        token += 4;
     }
 
-    // Parse RETURN clause (token 12)
-    string returnClause = tokenizedQuery[12];  // e.g., "MAX(Salary)"
-    openParen = returnClause.find('(');
-    closeParen = returnClause.find(')');
-    if (openParen == string::npos || closeParen == string::npos || closeParen <= openParen + 1) {
-        cout << "SYNTAX ERROR: Invalid RETURN clause format." << endl;
+    // Parse RETURN clause, e.g. "MAX(Salary) MIN(Salary)"
+    if (*token != "RETURN" || token + 1 == tokenizedQuery.end()) {
+        cout << "SYNTAX ERROR: Invalid GROUP BY query format." << endl;
         return false;
     }
-    parsedQuery.returnAggregateFunc = returnClause.substr(0, openParen);  // e.g., "MAX"
-    parsedQuery.returnAttribute = returnClause.substr(openParen + 1, closeParen - openParen - 1);  // e.g., "Salary"
+    for (++token; token != tokenizedQuery.end(); ++token) {
+        string aggregateFunc, attribute;
+        if (!parseAggregate(*token, aggregateFunc, attribute)) {
+            cout << "SYNTAX ERROR: Invalid RETURN clause format." << endl;
+            return false;
+        }
+        parsedQuery.returnAggregateFuncs.push_back(aggregateFunc);
+        parsedQuery.returnAttributes.push_back(attribute);
+    }
 
     return true;
 }
@@ -92,9 +122,23 @@ bool semanticParseGroupBy() {
 
     Table *table = tableCatalogue.getTable(parsedQuery.groupByTableName);
 
-    if (!table->isColumn(parsedQuery.groupByAttribute) ||
-        !table->isColumn(parsedQuery.havingAttribute)) {
-        cout << "SEMANTIC ERROR: Attribute doesn't exist in the table" << endl;
+    vector<string> attributes = parsedQuery.groupByAttributes;
+    attributes.insert(attributes.end(), parsedQuery.returnAttributes.begin(), parsedQuery.returnAttributes.end());
+    if (!parsedQuery.havingAttribute.empty())
+        attributes.push_back(parsedQuery.havingAttribute);
+    for (const string &attribute : attributes) {
+        if (!table->isColumn(attribute)) {
+            cout << "SEMANTIC ERROR: Attribute doesn't exist in the table" << endl;
+            return false;
+        }
+    }
+
+    // The result columns must have distinct names
+    set<string> resultColumns(parsedQuery.groupByAttributes.begin(), parsedQuery.groupByAttributes.end());
+    for (size_t aggregateCounter = 0; aggregateCounter < parsedQuery.returnAttributes.size(); ++aggregateCounter)
+        resultColumns.insert(parsedQuery.returnAggregateFuncs[aggregateCounter] + "(" + parsedQuery.returnAttributes[aggregateCounter] + ")");
+    if (resultColumns.size() != parsedQuery.groupByAttributes.size() + parsedQuery.returnAttributes.size()) {
+        cout << "SEMANTIC ERROR: Duplicate column in the result" << endl;
         return false;
     }
 
@@ -107,229 +151,682 @@ bool semanticParseGroupBy() {
 #include "matrix.h"
 #include "matrixCatalogue.h"
 #include "global.h"
+#include "externalsort.h"
 #include "bits/stdc++.h"
 using namespace std;
 
-bool compare(int val1, const string &op, int val2) {
-    if (op == "==") return val1 == val2;
-    if (op == "!=") return val1 != val2;
-    if (op == "<")  return val1 < val2;
-    if (op == "<=") return val1 <= val2;
-    if (op == ">")  return val1 > val2;
-    if (op == ">=") return val1 >= val2;
-    return false;
+bool compare(long long val1, BinaryOperator op, long long val2) {
+    switch (op) {
+        case EQUAL: return val1 == val2;
+        case NOT_EQUAL: return val1 != val2;
+        case LESS_THAN: return val1 < val2;
+        case LEQ: return val1 <= val2;
+        case GREATER_THAN: return val1 > val2;
+        case GEQ: return val1 >= val2;
+        default: return false;
+    }
+}
+
+enum AggregateFunction {
+    SUM_AGGREGATE,
+    COUNT_AGGREGATE,
+    AVG_AGGREGATE,
+    MIN_AGGREGATE,
+    MAX_AGGREGATE
+};
+
+static AggregateFunction parseAggregateFunction(const string &aggregateFunc) {
+    if (aggregateFunc == "COUNT") return COUNT_AGGREGATE;
+    if (aggregateFunc == "AVG") return AVG_AGGREGATE;
+    if (aggregateFunc == "MIN") return MIN_AGGREGATE;
+    if (aggregateFunc == "MAX") return MAX_AGGREGATE;
+    return SUM_AGGREGATE;
 }
 
-// Structure to hold intermediate aggregate values per group.
-struct AggData {
-    long long sum_having;
-    long long sum_return;
-    int count;
-    int min_having;
-    int max_having;
-    int min_return;
-    int max_return;
-    bool init;
-    AggData() : sum_having(0), sum_return(0), count(0),
-                min_having(numeric_limits<int>::max()), max_having(numeric_limits<int>::min()),
-                min_return(numeric_limits<int>::max()), max_return(numeric_limits<int>::min()),
-                init(false) {}
+/**
+ * @brief Layout of the aggregate state of a group. A state is stateWidth
+ * consecutive 64 bit values: the values of the keyCount key columns, the
+ * number of rows of the group, and one accumulator per aggregate (the sum
+ * for SUM and AVG, the smallest or largest value for MIN and MAX, unused for
+ * COUNT). States are kept in flat arrays and spilled to files as they are,
+ * so memory per group does not depend on the number of its rows, and sums
+ * do not overflow.
+ */
+struct GroupLayout {
+    int keyCount;
+    vector<AggregateFunction> functions;
+    int stateWidth;
+
+    GroupLayout(int keyCount, vector<AggregateFunction> functions)
+        : keyCount(keyCount), functions(functions), stateWidth(keyCount + 1 + functions.size()) {}
+
+    void initialise(long long *state, const int *keyValues) const {
+        copy(keyValues, keyValues + this->keyCount, state);
+        state[this->keyCount] = 0;
+        long long *accumulators = state + this->keyCount + 1;
+        for (size_t aggregateCounter = 0; aggregateCounter < this->functions.size(); ++aggregateCounter) {
+            if (this->functions[aggregateCounter] == MIN_AGGREGATE)
+                accumulators[aggregateCounter] = LLONG_MAX;
+            else if (this->functions[aggregateCounter] == MAX_AGGREGATE)
+                accumulators[aggregateCounter] = LLONG_MIN;
+            else
+                accumulators[aggregateCounter] = 0;
+        }
+    }
+
+    /**
+     * @brief Folds one row into the state of its group, given the values of
+     * the row's aggregated columns, one per aggregate.
+     */
+    void add(long long *state, const int *values) const {
+        state[this->keyCount]++;
+        long long *accumulators = state + this->keyCount + 1;
+        for (size_t aggregateCounter = 0; aggregateCounter < this->functions.size(); ++aggregateCounter) {
+            switch (this->functions[aggregateCounter]) {
+                case SUM_AGGREGATE:
+                case AVG_AGGREGATE: accumulators[aggregateCounter] += values[aggregateCounter]; break;
+                case MIN_AGGREGATE: accumulators[aggregateCounter] = min<long long>(accumulators[aggregateCounter], values[aggregateCounter]); break;
+                case MAX_AGGREGATE: accumulators[aggregateCounter] = max<long long>(accumulators[aggregateCounter], values[aggregateCounter]); break;
+                case COUNT_AGGREGATE: break;
+            }
+        }
+    }
+
+    /**
+     * @brief Folds the partial state of the same group computed over other
+     * rows into state.
+     */
+    void merge(long long *state, const long long *other) const {
+        state[this->keyCount] += other[this->keyCount];
+        long long *accumulators = state + this->keyCount + 1;
+        const long long *otherAccumulators = other + this->keyCount + 1;
+        for (size_t aggregateCounter = 0; aggregateCounter < this->functions.size(); ++aggregateCounter) {
+            switch (this->functions[aggregateCounter]) {
+                case SUM_AGGREGATE:
+                case AVG_AGGREGATE: accumulators[aggregateCounter] += otherAccumulators[aggregateCounter]; break;
+                case MIN_AGGREGATE: accumulators[aggregateCounter] = min(accumulators[aggregateCounter], otherAccumulators[aggregateCounter]); break;
+                case MAX_AGGREGATE: accumulators[aggregateCounter] = max(accumulators[aggregateCounter], otherAccumulators[aggregateCounter]); break;
+                case COUNT_AGGREGATE: break;
+            }
+        }
+    }
+
+    /**
+     * @brief Value of an aggregate over a complete group.
+     */
+    long long getValue(const long long *state, int aggregateIndex) const {
+        long long rowCount = state[this->keyCount];
+        long long accumulator = state[this->keyCount + 1 + aggregateIndex];
+        switch (this->functions[aggregateIndex]) {
+            case COUNT_AGGREGATE: return rowCount;
+            case AVG_AGGREGATE: return accumulator / rowCount;
+            default: return accumulator;
+        }
+    }
+
+    void getKey(const long long *state, int *keyValues) const {
+        copy(state, state + this->keyCount, keyValues);
+    }
 };
 
+/**
+ * @brief Packs the values of the key columns into one 64 bit integer, which
+ * is then the key of the group's hash table entry. Each column takes as many
+ * bits as the spread of its values needs, taken from the table's zone maps
+ * (which only ever widen, so they bound every value), or all 32 bits without
+ * zone maps. One or two key columns always fit.
+ */
+struct PackedKeyEncoder {
+    int keyCount = 0;
+    vector<long long> minValues;
+    vector<int> shifts;
+    bool isPackable = true;
+
+    PackedKeyEncoder(Table *table, const vector<int> &keyColumns) {
+        this->keyCount = keyColumns.size();
+        bool hasZoneMaps = table->zoneMaps.size() == table->blockCount;
+        for (const ZoneMap &zone : table->zoneMaps)
+            hasZoneMaps = hasZoneMaps && !zone.minValues.empty();
+        int shift = 0;
+        for (int columnIndex : keyColumns) {
+            long long minValue = INT_MIN, maxValue = INT_MAX;
+            if (hasZoneMaps && !table->zoneMaps.empty()) {
+                minValue = LLONG_MAX;
+                maxValue = LLONG_MIN;
+                for (const ZoneMap &zone : table->zoneMaps) {
+                    minValue = min<long long>(minValue, zone.minValues[columnIndex]);
+                    maxValue = max<long long>(maxValue, zone.maxValues[columnIndex]);
+                }
+            }
+            int bits = max(1, 64 - __builtin_clzll(max(1LL, maxValue - minValue)));
+            this->minValues.push_back(minValue);
+            this->shifts.push_back(shift);
+            shift += bits;
+        }
+        this->isPackable = shift <= 64;
+    }
+
+    uint64_t operator()(const int *keyValues) const {
+        uint64_t key = 0;
+        for (int keyCounter = 0; keyCounter < this->keyCount; ++keyCounter)
+            key |= (uint64_t)(keyValues[keyCounter] - this->minValues[keyCounter]) << this->shifts[keyCounter];
+        return key;
+    }
+};
 
-bool compareRows(const vector<int>& row1, const vector<int>& row2) {
-    return row1[0] < row2[0]; // Sort based on the first attribute (DepartmentID)
+/**
+ * @brief Keys of too many or too widely spread columns to pack: the bytes of
+ * the key values.
+ */
+struct ByteKeyEncoder {
+    int keyCount;
+
+    string operator()(const int *keyValues) const {
+        return string((const char *)keyValues, this->keyCount * sizeof(int));
+    }
+};
+
+static uint64_t hashGroupKey(uint64_t key) {
+    return key;
 }
 
+static uint64_t hashGroupKey(const string &key) {
+    return hash<string>{}(key);
+}
 
-#include "global.h"
+// A partition that still holds too many groups after this many partitioning
+// passes is aggregated in memory regardless
+const int MAX_GROUPBY_DEPTH = 8;
 
 /**
- * @brief Executes the GROUP BY query with HAVING clause using 10 blocks at a time.
+ * @brief Partition of a group key at a given partitioning pass. Every pass
+ * hashes with a different seed, so repartitioning a partition spreads its
+ * keys over new partitions.
  */
-void executeGroupBy() {
-    logger.log("executeGROUPBY");
+static int getGroupPartition(uint64_t keyHash, int level, int partitionCount) {
+    uint64_t hash = keyHash + (level + 1) * 0x9E3779B97F4A7C15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+    return (hash ^ (hash >> 31)) % partitionCount;
+}
 
-    // Configuration for external memory processing
-    const int MAX_BLOCKS = 10;             // Limit memory usage to 10 blocks
-    const int NUM_PARTITIONS = 10;         // Number of partitions
+/**
+ * @brief Number of partitions a pass of hash aggregation spills to: half of
+ * the BLOCK_COUNT pages, at least two, each buffering one page of states.
+ */
+static int getGroupPartitionCount() {
+    return max(2, (int)BLOCK_COUNT / 2);
+}
 
-    // Get the table
-    Table *table = tableCatalogue.getTable(parsedQuery.groupByTableName);
-    int groupByIndex = table->getColumnIndex(parsedQuery.groupByAttribute);
-    int havingIndex = table->getColumnIndex(parsedQuery.havingAttribute);
-    int returnIndex = table->getColumnIndex(parsedQuery.returnAttribute);
-
-    // Partition management
-    vector<int> partitionFileCounters(NUM_PARTITIONS, 0);
-    vector<vector<string>> partitionFiles(NUM_PARTITIONS);
-
-    // First Pass: Partition the data in 10-block batches
-    Cursor cursor = table->getCursor();
-    while (true) {
-        vector<vector<int>> batchRows;
-
-        // Read the next batch of 10 blocks
-        for (int i = 0; i < MAX_BLOCKS; ++i) {
-            vector<int> row = cursor.getNext();
-            if (row.empty()) break;
-            batchRows.push_back(row);
-        }
+static size_t getStatesPerPage(const GroupLayout &layout) {
+    return max<size_t>(1, (size_t)(BLOCK_SIZE * 1000) / (layout.stateWidth * sizeof(long long)));
+}
 
-        if (batchRows.empty()) break;
+/**
+ * @brief Number of groups the hash table of a pass can hold: the pages left
+ * over by the partition buffers, less one page for reading the input.
+ */
+static size_t getMemoryGroups(const GroupLayout &layout) {
+    return (size_t)max(1, (int)BLOCK_COUNT - 1 - getGroupPartitionCount()) * getStatesPerPage(layout);
+}
 
-        // Partitioning phase
-        unordered_map<int, vector<vector<int>>> partitionBuffers[NUM_PARTITIONS];
+/**
+ * @brief Number of groups that can be aggregated within the memory budget
+ * in MAX_GROUPBY_DEPTH partitioning passes.
+ */
+static long long getMaxGroups(const GroupLayout &layout) {
+    long long maxGroups = getMemoryGroups(layout);
+    for (int pass = 0; pass < MAX_GROUPBY_DEPTH && maxGroups < LLONG_MAX / getGroupPartitionCount(); ++pass)
+        maxGroups *= getGroupPartitionCount();
+    return maxGroups;
+}
 
-        for (const auto &row : batchRows) {
-            int key = row[groupByIndex];
-            int partition = std::abs(static_cast<int>(hash<int>{}(key) % NUM_PARTITIONS));
+/**
+ * @brief One pass of external hash aggregation: a hash table of group states
+ * with a memory budget, and the partition files for the groups that do not
+ * fit in it.
+ *
+ * <p>
+ * A group already in the hash table keeps being updated there, so the groups
+ * in memory are complete once the input ends; the states of every other
+ * group are spilled, by hash of the key, to its partition's file, a page at
+ * a time. Each partition file then goes through a pass of its own, with a
+ * new hash seed, until its groups fit. The hash table maps the key (see
+ * PackedKeyEncoder and ByteKeyEncoder) to the group's state in a flat array.
+ * </p>
+ */
+template <typename KeyEncoder>
+class GroupAggregator {
+    using Key = decltype(declval<KeyEncoder>()(nullptr));
+
+    const GroupLayout &layout;
+    KeyEncoder encodeKey;
+    int level;
+    string filePrefix;
+    int partitionCount;
+    size_t memoryGroups;
+    size_t statesPerPage;
+    unordered_map<Key, size_t> groups;
+    vector<long long> states;
+    vector<int> keyValues;
+    vector<vector<long long>> pages;
+    vector<ofstream> files;
+    vector<long long> spilledCounts;
+
+    string getFileName(int partition) {
+        return this->filePrefix + "_" + to_string(partition);
+    }
 
-            // Add row to partition buffer
-            partitionBuffers[partition][key].push_back(row);
+    void flushPage(int partition) {
+        if (!this->files[partition].is_open())
+            this->files[partition].open(this->getFileName(partition), ios::binary | ios::trunc);
+        this->files[partition].write((const char *)this->pages[partition].data(), this->pages[partition].size() * sizeof(long long));
+        this->pages[partition].clear();
+    }
 
-            // Write to disk when buffer limit reaches table->maxRowsPerBlock
-            if (partitionBuffers[partition][key].size() >= table->maxRowsPerBlock) {
-                string filename = "../data/temp/groupby_" + to_string(partition) + 
-                                  "_" + to_string(partitionFileCounters[partition]++) + ".csv";
-                partitionFiles[partition].push_back(filename);
+    public:
 
-                ofstream file(filename, ios::out | ios::app);
-                for (const auto &groupRow : partitionBuffers[partition][key]) {
-                    for (size_t i = 0; i < groupRow.size(); ++i) {
-                        file << groupRow[i];
-                        if (i < groupRow.size() - 1) file << ",";
-                    }
-                    file << "\n";
-                }
-                file.close();
+    GroupAggregator(const GroupLayout &layout, KeyEncoder encodeKey, int level, string filePrefix)
+        : layout(layout), encodeKey(encodeKey), level(level), filePrefix(filePrefix) {
+        this->partitionCount = getGroupPartitionCount();
+        this->statesPerPage = getStatesPerPage(layout);
+        this->memoryGroups = getMemoryGroups(layout);
+        this->keyValues.resize(layout.keyCount);
+    }
 
-                // Clear the buffer
-                partitionBuffers[partition][key].clear();
-            }
+    /**
+     * @brief The state of the group in the hash table, which is added if
+     * there is room for it, or nullptr if the group has to be spilled.
+     */
+    long long *getGroup(const int *keyValues) {
+        Key key = this->encodeKey(keyValues);
+        auto group = this->groups.find(key);
+        if (group != this->groups.end())
+            return &this->states[group->second];
+        if (this->groups.size() >= this->memoryGroups && this->level < MAX_GROUPBY_DEPTH)
+            return nullptr;
+        size_t offset = this->states.size();
+        this->states.resize(offset + this->layout.stateWidth);
+        this->layout.initialise(&this->states[offset], keyValues);
+        this->groups.emplace(key, offset);
+        return &this->states[offset];
+    }
+
+    void spill(const long long *state) {
+        if (this->pages.empty()) {
+            this->pages.resize(this->partitionCount);
+            this->files.resize(this->partitionCount);
+            this->spilledCounts.assign(this->partitionCount, 0);
         }
+        this->layout.getKey(state, this->keyValues.data());
+        int partition = getGroupPartition(hashGroupKey(this->encodeKey(this->keyValues.data())), this->level, this->partitionCount);
+        this->pages[partition].insert(this->pages[partition].end(), state, state + this->layout.stateWidth);
+        this->spilledCounts[partition]++;
+        if (this->pages[partition].size() >= this->statesPerPage * this->layout.stateWidth)
+            this->flushPage(partition);
+    }
 
-        // Flush remaining buffers
-        for (int p = 0; p < NUM_PARTITIONS; ++p) {
-            for (auto &buffer : partitionBuffers[p]) {
-                if (!buffer.second.empty()) {
-                    string filename = "../data/temp/groupby_" + to_string(p) + 
-                                      "_" + to_string(partitionFileCounters[p]++) + ".csv";
-                    partitionFiles[p].push_back(filename);
-
-                    ofstream file(filename, ios::out | ios::app);
-                    for (const auto &groupRow : buffer.second) {
-                        for (size_t i = 0; i < groupRow.size(); ++i) {
-                            file << groupRow[i];
-                            if (i < groupRow.size() - 1) file << ",";
-                        }
-                        file << "\n";
-                    }
-                    file.close();
-                }
+    void add(const long long *state) {
+        this->layout.getKey(state, this->keyValues.data());
+        long long *group = this->getGroup(this->keyValues.data());
+        if (group)
+            this->layout.merge(group, state);
+        else
+            this->spill(state);
+    }
+
+    /**
+     * @brief Hands every complete group to emit: first the groups in memory,
+     * then those of each partition file, aggregated by a pass of their own.
+     */
+    void finish(function<void(const long long *)> emit) {
+        for (size_t offset = 0; offset < this->states.size(); offset += this->layout.stateWidth)
+            emit(&this->states[offset]);
+        this->groups.clear();
+        this->states.clear();
+        this->states.shrink_to_fit();
+        for (int partition = 0; partition < (int)this->pages.size(); ++partition) {
+            if (!this->pages[partition].empty())
+                this->flushPage(partition);
+            this->files[partition].close();
+        }
+        vector<long long> page(this->statesPerPage * this->layout.stateWidth);
+        for (int partition = 0; partition < (int)this->spilledCounts.size(); ++partition) {
+            if (this->spilledCounts[partition] == 0)
+                continue;
+            GroupAggregator partitionAggregator(this->layout, this->encodeKey, this->level + 1, this->getFileName(partition));
+            ifstream fin(this->getFileName(partition), ios::binary);
+            while (fin.read((char *)page.data(), page.size() * sizeof(long long)) || fin.gcount() > 0) {
+                size_t valueCount = fin.gcount() / sizeof(long long);
+                for (size_t offset = 0; offset + this->layout.stateWidth <= valueCount; offset += this->layout.stateWidth)
+                    partitionAggregator.add(&page[offset]);
             }
+            fin.close();
+            bufferManager.deleteFile(this->getFileName(partition));
+            partitionAggregator.finish(emit);
         }
     }
+};
+
+/**
+ * @brief Parallel hash aggregation of a table over taskCount workers of the
+ * thread pool, in two phases that share nothing but their inputs, so no lock
+ * is taken on the way.
+ *
+ * <p>
+ * In the first phase every worker reads its own range of blocks straight from
+ * the table's segment and pre-aggregates their rows in a hash table of its
+ * own, which gets 1 / taskCount of the memory budget. Whenever that table is
+ * full, and at the end, its partial states are radix partitioned on the hash
+ * of the key into taskCount partitions of a page buffer each, and a full page
+ * is written to the worker's file for the partition. In the second phase
+ * each worker takes one partition, merges the partial states every worker
+ * left for it through a GroupAggregator of its own and hands the complete
+ * groups to emit. The partial states of a group all land in the same
+ * partition, so partitions are merged independently, and emit is called
+ * concurrently for different partitions.
+ * </p>
+ */
+template <typename KeyEncoder>
+static void aggregateInParallel(Table *table, const vector<int> &projectedColumns, const GroupLayout &layout, KeyEncoder encodeKey, string filePrefix, int taskCount, function<void(int, const long long *)> emit) {
+    logger.log("aggregateInParallel");
+    using Key = decltype(encodeKey(nullptr));
+    int partitionCount = taskCount;
+    size_t statesPerPage = getStatesPerPage(layout);
+    size_t pageValues = statesPerPage * layout.stateWidth;
+    size_t localGroups = max(statesPerPage, getMemoryGroups(layout) / taskCount);
+    auto getSpillFileName = [&](int task, int partition) {
+        return filePrefix + "_W" + to_string(task) + "_" + to_string(partition);
+    };
 
-    // Prepare result storage
-    vector<vector<int>> resultRows;
-
-    // Second Pass: Process each partition within memory constraints
-    for (int p = 0; p < NUM_PARTITIONS; ++p) {
-        if (partitionFiles[p].empty()) continue;
-
-        // For each partition, process files in blocks
-        for (const auto &file : partitionFiles[p]) {
-            // Read file contents
-            ifstream inputFile(file);
-            vector<vector<int>> partitionData;
-            string line;
-            while (getline(inputFile, line)) {
-                vector<int> row;
-                stringstream ss(line);
-                string cell;
-                while (getline(ss, cell, ',')) {
-                    row.push_back(stoi(cell));
+    // Partial states each worker leaves in its page buffers, and whether it
+    // wrote any to a file, by partition
+    vector<vector<vector<long long>>> partialStates(taskCount, vector<vector<long long>>(partitionCount));
+    vector<vector<char>> isSpilled(taskCount, vector<char>(partitionCount, false));
+
+    // Dirty pages are written back so the segment can be read directly
+    bufferManager.flush(table->tableName);
+    int fd = bufferManager.getSegment(table->tableName);
+    threadPool.parallelFor(taskCount, [&](int task) {
+        unordered_map<Key, size_t> groups;
+        vector<long long> states;
+        vector<vector<long long>> &pages = partialStates[task];
+        vector<ofstream> files(partitionCount);
+        vector<int> keyValues(layout.keyCount);
+        auto scatterGroups = [&]() {
+            for (size_t offset = 0; offset < states.size(); offset += layout.stateWidth) {
+                layout.getKey(&states[offset], keyValues.data());
+                int partition = getGroupPartition(hashGroupKey(encodeKey(keyValues.data())), 0, partitionCount);
+                pages[partition].insert(pages[partition].end(), states.begin() + offset, states.begin() + offset + layout.stateWidth);
+                if (pages[partition].size() < pageValues)
+                    continue;
+                if (!files[partition].is_open())
+                    files[partition].open(getSpillFileName(task, partition), ios::binary | ios::trunc);
+                files[partition].write((const char *)pages[partition].data(), pages[partition].size() * sizeof(long long));
+                pages[partition].clear();
+                isSpilled[task][partition] = true;
+            }
+            groups.clear();
+            states.clear();
+        };
+
+        uint firstBlock = (uint64_t)table->blockCount * task / taskCount;
+        uint lastBlock = (uint64_t)table->blockCount * (task + 1) / taskCount;
+        vector<int> row(projectedColumns.size());
+        for (uint blockCounter = firstBlock; blockCounter < lastBlock; ++blockCounter) {
+            Page page(table->tableName, blockCounter, fd);
+            int rowCount = page.getRowCount();
+            for (int rowCounter = 0; rowCounter < rowCount; ++rowCounter) {
+                for (size_t columnCounter = 0; columnCounter < projectedColumns.size(); ++columnCounter)
+                    row[columnCounter] = page.getValue(rowCounter, projectedColumns[columnCounter]);
+                Key key = encodeKey(row.data());
+                auto group = groups.find(key);
+                if (group == groups.end()) {
+                    if (groups.size() >= localGroups)
+                        scatterGroups();
+                    size_t offset = states.size();
+                    states.resize(offset + layout.stateWidth);
+                    layout.initialise(&states[offset], row.data());
+                    group = groups.emplace(key, offset).first;
                 }
-                partitionData.push_back(row);
+                layout.add(&states[group->second], row.data() + layout.keyCount);
             }
-            inputFile.close();
-
-            // Group and aggregate within this partition
-            unordered_map<int, vector<vector<int>>> groups;
-            for (const auto &row : partitionData) {
-                int key = row[groupByIndex];
-                groups[key].push_back(row);
+        }
+        scatterGroups();
+    });
+
+    threadPool.parallelFor(partitionCount, [&](int partition) {
+        GroupAggregator aggregator(layout, encodeKey, 1, filePrefix + "_P" + to_string(partition));
+        vector<long long> page(pageValues);
+        for (int task = 0; task < taskCount; ++task) {
+            if (isSpilled[task][partition]) {
+                ifstream fin(getSpillFileName(task, partition), ios::binary);
+                while (fin.read((char *)page.data(), page.size() * sizeof(long long)) || fin.gcount() > 0) {
+                    size_t valueCount = fin.gcount() / sizeof(long long);
+                    for (size_t offset = 0; offset + layout.stateWidth <= valueCount; offset += layout.stateWidth)
+                        aggregator.add(&page[offset]);
+                }
+                fin.close();
+                bufferManager.deleteFile(getSpillFileName(task, partition));
             }
+            vector<long long> &states = partialStates[task][partition];
+            for (size_t offset = 0; offset < states.size(); offset += layout.stateWidth)
+                aggregator.add(&states[offset]);
+            vector<long long>().swap(states);
+        }
+        aggregator.finish([&](const long long *state) {
+            emit(partition, state);
+        });
+    });
+}
 
-            // Process each group
-            for (auto &group : groups) {
-                int groupKey = group.first;
-                vector<vector<int>> &rows = group.second;
-
-                // Compute HAVING aggregate
-                int havingAggValue = 0;
-                if (parsedQuery.havingAggregateFunc == "SUM") {
-                    havingAggValue = accumulate(rows.begin(), rows.end(), 0,
-                        [&](int sum, const vector<int> &row) { return sum + row[havingIndex]; });
-                } else if (parsedQuery.havingAggregateFunc == "COUNT") {
-                    havingAggValue = rows.size();
-                } else if (parsedQuery.havingAggregateFunc == "AVG") {
-                    havingAggValue = accumulate(rows.begin(), rows.end(), 0,
-                        [&](int sum, const vector<int> &row) { return sum + row[havingIndex]; }) / rows.size();
-                } else if (parsedQuery.havingAggregateFunc == "MAX") {
-                    havingAggValue = numeric_limits<int>::min();
-                    for (const auto &row : rows)
-                        havingAggValue = max(havingAggValue, row[havingIndex]);
-                } else if (parsedQuery.havingAggregateFunc == "MIN") {
-                    havingAggValue = numeric_limits<int>::max();
-                    for (const auto &row : rows)
-                        havingAggValue = min(havingAggValue, row[havingIndex]);
-                }
+/**
+ * @brief Whether the rows of the table are stored in ascending order of the
+ * grouping columns, so the rows of a group are adjacent.
+ */
+static bool isSortedOnGroupKey(Table *table, const vector<string> &groupByAttributes) {
+    if (table->sortColumns.size() < groupByAttributes.size())
+        return false;
+    for (size_t keyCounter = 0; keyCounter < groupByAttributes.size(); ++keyCounter)
+        if (table->sortColumns[keyCounter] != groupByAttributes[keyCounter] || !table->sortDirections[keyCounter])
+            return false;
+    return true;
+}
 
-                // Apply HAVING condition
-                if (!compare(havingAggValue, parsedQuery.havingOperator, parsedQuery.havingValue))
-                    continue;
+/**
+ * @brief Executes the GROUP BY query. Every group keeps only its aggregate
+ * state (see GroupLayout) holding all the aggregates at once, which each row
+ * updates as it is read, so memory grows with the number of groups and not
+ * with the number of rows, and the table is read once however many
+ * aggregates are asked for.
+ *
+ * <p>
+ * A table sorted on the grouping columns is aggregated in a single streaming
+ * pass that needs the state of one group only. So is a table grouped on one
+ * column that has more distinct values (as estimated by its statistics) than
+ * hash aggregation can handle within its memory budget, after it is sorted
+ * with ExternalSort. Any other table is aggregated in a hash table,
+ * externally through GroupAggregator if its groups do not fit in the
+ * BLOCK_COUNT pages, as that is cheaper than sorting it. With more than one
+ * worker thread the hash table is built by aggregateInParallel, every worker
+ * over its own share of the blocks. Either way every group is written to the
+ * result as soon as it is complete; the result of hash aggregation is then
+ * sorted with ExternalSort, so it is in ascending order of the grouping
+ * columns like that of the streaming pass.
+ * </p>
+ * <p>
+ * Aggregates are computed in 64 bits. A result that does not fit in a column
+ * of the result table is clamped to the int range, with a warning.
+ * </p>
+ */
+void executeGroupBy() {
+    logger.log("executeGROUPBY");
 
-                // Compute RETURN aggregate
-                int returnAggValue = 0;
-                if (parsedQuery.returnAggregateFunc == "SUM") {
-                    returnAggValue = accumulate(rows.begin(), rows.end(), 0,
-                        [&](int sum, const vector<int> &row) { return sum + row[returnIndex]; });
-                } else if (parsedQuery.returnAggregateFunc == "COUNT") {
-                    returnAggValue = rows.size();
-                } else if (parsedQuery.returnAggregateFunc == "AVG") {
-                    returnAggValue = accumulate(rows.begin(), rows.end(), 0,
-                        [&](int sum, const vector<int> &row) { return sum + row[returnIndex]; }) / rows.size();
-                } else if (parsedQuery.returnAggregateFunc == "MAX") {
-                    returnAggValue = numeric_limits<int>::min();
-                    for (const auto &row : rows)
-                        returnAggValue = max(returnAggValue, row[returnIndex]);
-                } else if (parsedQuery.returnAggregateFunc == "MIN") {
-                    returnAggValue = numeric_limits<int>::max();
-                    for (const auto &row : rows)
-                        returnAggValue = min(returnAggValue, row[returnIndex]);
-                }
+    // Get the table
+    Table *table = tableCatalogue.getTable(parsedQuery.groupByTableName);
 
-                // Store result row
-                resultRows.push_back({groupKey, returnAggValue});
-            }
-        }
+    // The key columns are read first, then the column of every aggregate;
+    // the HAVING aggregate, if any, is the last one
+    vector<int> projectedColumns;
+    for (const string &attribute : parsedQuery.groupByAttributes)
+        projectedColumns.push_back(table->getColumnIndex(attribute));
+    vector<string> aggregateFuncs = parsedQuery.returnAggregateFuncs;
+    vector<string> aggregateAttributes = parsedQuery.returnAttributes;
+    bool hasHaving = !parsedQuery.havingAggregateFunc.empty();
+    if (hasHaving) {
+        aggregateFuncs.push_back(parsedQuery.havingAggregateFunc);
+        aggregateAttributes.push_back(parsedQuery.havingAttribute);
     }
-
-    // Sort the result rows on the groupBy attribute (first column)
-    sort(resultRows.begin(), resultRows.end(), compareRows);
+    vector<AggregateFunction> functions;
+    for (size_t aggregateCounter = 0; aggregateCounter < aggregateFuncs.size(); ++aggregateCounter) {
+        functions.push_back(parseAggregateFunction(aggregateFuncs[aggregateCounter]));
+        projectedColumns.push_back(table->getColumnIndex(aggregateAttributes[aggregateCounter]));
+    }
+    int keyCount = parsedQuery.groupByAttributes.size();
+    int returnCount = parsedQuery.returnAggregateFuncs.size();
+    GroupLayout layout(keyCount, functions);
+    BinaryOperator havingOperator = parseBinaryOperator(parsedQuery.havingOperator);
 
     // Create the resultant table with proper column names
-    vector<string> columnNames = { 
-        parsedQuery.groupByAttribute, 
-        parsedQuery.returnAggregateFunc + "(" + parsedQuery.returnAttribute + ")" 
-    };
+    vector<string> columnNames = parsedQuery.groupByAttributes;
+    for (int aggregateCounter = 0; aggregateCounter < returnCount; ++aggregateCounter)
+        columnNames.push_back(parsedQuery.returnAggregateFuncs[aggregateCounter] + "(" + parsedQuery.returnAttributes[aggregateCounter] + ")");
     Table *resultantTable = new Table(parsedQuery.groupByResultRelationName, columnNames);
+    ofstream fout(resultantTable->sourceFileName, ios::app);
+
+    // Result row of a complete group, or false if HAVING rejects the group
+    long long clampedCount = 0;
+    auto getResultRow = [&](const long long *state, vector<int> &resultRow, long long &clampedCount) {
+        if (hasHaving && !compare(layout.getValue(state, returnCount), havingOperator, parsedQuery.havingValue))
+            return false;
+        resultRow.resize(keyCount + returnCount);
+        layout.getKey(state, resultRow.data());
+        for (int aggregateCounter = 0; aggregateCounter < returnCount; ++aggregateCounter) {
+            long long value = layout.getValue(state, aggregateCounter);
+            if (value < INT_MIN || value > INT_MAX)
+                clampedCount++;
+            resultRow[keyCount + aggregateCounter] = clamp<long long>(value, INT_MIN, INT_MAX);
+        }
+        return true;
+    };
+
+    // Gathers the key values and the aggregated values of every row of the
+    // input, a batch at a time
+    auto forEachRow = [&](Table *input, auto rowFunction) {
+        Cursor cursor = input->getCursor(projectedColumns);
+        RowBatch batch;
+        vector<span<const int>> columns(projectedColumns.size());
+        vector<int> row(projectedColumns.size());
+        while (cursor.nextBatch(batch)) {
+            for (size_t columnCounter = 0; columnCounter < columns.size(); ++columnCounter)
+                columns[columnCounter] = batch.getColumn(columnCounter);
+            for (int rowCounter = 0; rowCounter < batch.rowCount; ++rowCounter) {
+                for (size_t columnCounter = 0; columnCounter < columns.size(); ++columnCounter)
+                    row[columnCounter] = columns[columnCounter][rowCounter];
+                rowFunction(row.data(), row.data() + keyCount);
+            }
+        }
+    };
 
-    for (const auto &row : resultRows) {
-        resultantTable->writeRow<int>(row);
+    long long expectedGroups = table->columnStatistics.empty() || keyCount != 1 ? 0 : table->columnStatistics[projectedColumns[0]].estimateDistinctCount();
+    bool isSorted = isSortedOnGroupKey(table, parsedQuery.groupByAttributes);
+    bool useSort = isSorted || expectedGroups > getMaxGroups(layout);
+    if (useSort) {
+        logger.log("executeGROUPBY: sort-based aggregation");
+        Table *sortedTable = table;
+        string sortedTableName = parsedQuery.groupByResultRelationName + "_GroupByInput";
+        if (!isSorted) {
+            ExternalSort externalsort(table, {}, {});
+            externalsort.performOrderBy(sortedTableName, parsedQuery.groupByAttributes[0], true);
+            sortedTable = tableCatalogue.getTable(sortedTableName);
+        }
+
+        // Rows of a group are adjacent, so a group is complete as soon as
+        // the key changes
+        vector<long long> state(layout.stateWidth);
+        vector<int> groupKey(keyCount);
+        bool inGroup = false;
+        vector<int> resultRow;
+        forEachRow(sortedTable, [&](const int *keyValues, const int *values) {
+            if (!inGroup || !equal(groupKey.begin(), groupKey.end(), keyValues)) {
+                if (inGroup && getResultRow(state.data(), resultRow, clampedCount))
+                    resultantTable->writeRow<int>(resultRow, fout);
+                inGroup = true;
+                groupKey.assign(keyValues, keyValues + keyCount);
+                layout.initialise(state.data(), keyValues);
+            }
+            layout.add(state.data(), values);
+        });
+        if (inGroup && getResultRow(state.data(), resultRow, clampedCount))
+            resultantTable->writeRow<int>(resultRow, fout);
+        if (!isSorted)
+            tableCatalogue.deleteTable(sortedTableName);
+    } else {
+        string filePrefix = "../data/temp/" + parsedQuery.groupByResultRelationName + "_GroupBy";
+        int taskCount = min<long long>(threadPool.getThreadCount(), table->blockCount);
+        auto aggregate = [&](auto encodeKey) {
+            if (taskCount > 1) {
+                // Every partition writes its groups to a file of its own,
+                // which is then appended to the result
+                vector<string> partitionFileNames;
+                vector<ofstream> partitionFiles(taskCount);
+                vector<long long> partitionClampedCounts(taskCount, 0);
+                for (int partition = 0; partition < taskCount; ++partition) {
+                    partitionFileNames.push_back(filePrefix + "_R" + to_string(partition));
+                    partitionFiles[partition].open(partitionFileNames[partition], ios::trunc);
+                }
+                aggregateInParallel(table, projectedColumns, layout, encodeKey, filePrefix, taskCount, [&](int partition, const long long *state) {
+                    vector<int> resultRow;
+                    if (getResultRow(state, resultRow, partitionClampedCounts[partition]))
+                        resultantTable->writeRow<int>(resultRow, partitionFiles[partition]);
+                });
+                for (int partition = 0; partition < taskCount; ++partition) {
+                    partitionFiles[partition].close();
+                    ifstream fin(partitionFileNames[partition]);
+                    if (fin.peek() != ifstream::traits_type::eof())
+                        fout << fin.rdbuf();
+                    fin.close();
+                    bufferManager.deleteFile(partitionFileNames[partition]);
+                    clampedCount += partitionClampedCounts[partition];
+                }
+                return;
+            }
+            GroupAggregator aggregator(layout, encodeKey, 0, filePrefix);
+            vector<long long> rowState(layout.stateWidth);
+            // Single pass over the table, one batch at a time
+            forEachRow(table, [&](const int *keyValues, const int *values) {
+                long long *group = aggregator.getGroup(keyValues);
+                if (group) {
+                    layout.add(group, values);
+                    return;
+                }
+                layout.initialise(rowState.data(), keyValues);
+                layout.add(rowState.data(), values);
+                aggregator.spill(rowState.data());
+            });
+            vector<int> resultRow;
+            aggregator.finish([&](const long long *state) {
+                if (getResultRow(state, resultRow, clampedCount))
+                    resultantTable->writeRow<int>(resultRow, fout);
+            });
+        };
+        PackedKeyEncoder packedKeyEncoder(table, vector<int>(projectedColumns.begin(), projectedColumns.begin() + keyCount));
+        if (packedKeyEncoder.isPackable)
+            aggregate(packedKeyEncoder);
+        else
+            aggregate(ByteKeyEncoder{keyCount});
     }
+    fout.close();
+    if (clampedCount > 0)
+        cout << "WARNING: " << clampedCount << " aggregate values do not fit in an int and were clamped" << endl;
     resultantTable->blockify();
     tableCatalogue.insertTable(resultantTable);
+    // Groups come out of the hash table in no particular order, so the
+    // result is sorted on the grouping columns
+    if (!useSort && resultantTable->rowCount > 1) {
+        ExternalSort externalsort(resultantTable, parsedQuery.groupByAttributes, vector<bool>(keyCount, true));
+        externalsort.performExternalSort(false);
+    }
+    resultantTable->sortColumns = parsedQuery.groupByAttributes;
+    resultantTable->sortDirections = vector<bool>(keyCount, true);
 }
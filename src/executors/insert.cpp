@@ -90,13 +90,12 @@ void executeINSERT()
             values.push_back(0);
         }
     }
-    // Insert the row into the table
+    // Insert the row into the table. It only changes the cached last page,
+    // which the buffer manager writes back when it is evicted or flushed
     sourceTable->insertRow(values);
-    // Check and update index for the indexed column
-    if (sourceTable->indexed)
-    {
-        cout<<"TODO: Update index for the indexed column."<<endl;
-    }
+    // The indices of the table do not know the new row yet; they are rebuilt
+    // when one of them is next used
+    SecondaryIndex::markIndexesStale(sourceTable->tableName);
     
     // Print the inserted row
     cout << "Inserted row: ";
@@ -1,13 +1,22 @@
 #include "global.h"
 #include "externalsort.h"
+#include "secondary_index.h"
 /**
  * @brief 
  * SYNTAX: R <- JOIN relation_name1, relation_name2 ON column_name1 , column_name2
+ *         R <- JOIN relation_name1, relation_name2 ON column_name1 bin_op column_name2
+ *         R <- JOIN relation_name1, relation_name2 ON column_name1 bin_op column_name2 AND column_name3 bin_op column_name4
+ *
+ * The first form is an equi-join. In the others the first column of every
+ * condition belongs to relation_name1 and the second to relation_name2; a
+ * band join such as "ts BETWEEN start AND end" is written as
+ * "ts >= start AND ts <= end".
  */
 bool syntacticParseJOIN()
 {
     logger.log("syntacticParseJOIN");
-    if (tokenizedQuery.size() != 8 || tokenizedQuery[5] != "ON")
+    int querySize = tokenizedQuery.size();
+    if ((querySize != 8 && querySize != 9 && querySize != 13) || tokenizedQuery[5] != "ON" || (querySize == 13 && tokenizedQuery[9] != "AND"))
     {
         cout << "SYNTAC ERROR" << endl;
         cout<< "tokenizedQuery.size() "<<tokenizedQuery.size()<<endl;
@@ -18,26 +27,30 @@ bool syntacticParseJOIN()
     parsedQuery.joinFirstRelationName = tokenizedQuery[3];
     parsedQuery.joinSecondRelationName = tokenizedQuery[4];
     parsedQuery.joinFirstColumnName = tokenizedQuery[6];
-    parsedQuery.joinSecondColumnName = tokenizedQuery[7];
-
-    // string binaryOperator = tokenizedQuery[7];
-    // if (binaryOperator == "<")
-    //     parsedQuery.joinBinaryOperator = LESS_THAN;
-    // else if (binaryOperator == ">")
-    //     parsedQuery.joinBinaryOperator = GREATER_THAN;
-    // else if (binaryOperator == ">=" || binaryOperator == "=>")
-    //     parsedQuery.joinBinaryOperator = GEQ;
-    // else if (binaryOperator == "<=" || binaryOperator == "=<")
-    //     parsedQuery.joinBinaryOperator = LEQ;
-    // else if (binaryOperator == "==")
-    //     parsedQuery.joinBinaryOperator = EQUAL;
-    // else if (binaryOperator == "!=")
-    //     parsedQuery.joinBinaryOperator = NOT_EQUAL;
-    // else
-    // {
-    //     cout << "SYNTAX ERROR" << endl;
-    //     return false;
-    // }
+    if (querySize == 8)
+    {
+        parsedQuery.joinBinaryOperator = EQUAL;
+        parsedQuery.joinSecondColumnName = tokenizedQuery[7];
+        return true;
+    }
+    parsedQuery.joinBinaryOperator = parseBinaryOperator(tokenizedQuery[7]);
+    parsedQuery.joinSecondColumnName = tokenizedQuery[8];
+    if (querySize == 13)
+    {
+        parsedQuery.joinThirdColumnName = tokenizedQuery[10];
+        parsedQuery.joinSecondBinaryOperator = parseBinaryOperator(tokenizedQuery[11]);
+        parsedQuery.joinFourthColumnName = tokenizedQuery[12];
+        if (parsedQuery.joinSecondBinaryOperator == NO_BINOP_CLAUSE)
+        {
+            cout << "SYNTAX ERROR" << endl;
+            return false;
+        }
+    }
+    if (parsedQuery.joinBinaryOperator == NO_BINOP_CLAUSE)
+    {
+        cout << "SYNTAX ERROR" << endl;
+        return false;
+    }
     return true;
 }
 
@@ -62,201 +75,692 @@ bool semanticParseJOIN()
         cout << "SEMANTIC ERROR: Column doesn't exist in relation" << endl;
         return false;
     }
-    return true;
-}
-
 
-int hashFunction(int key, int num_of_partitions) {
-    return hash<int>{}(key) % num_of_partitions;
-}
-
-void writeRowsToCSV(const string &filename, const vector<vector<int>> &rows) {
-    ofstream file(filename, ios::out | ios::app);
-    if (!file.is_open()) {
-        logger.log("Error opening file: " + filename);
-        return;
-    }
-    logger.log("Writing to file: " + filename);
-    for (const auto &row : rows) {
-        for (size_t i = 0; i < row.size(); ++i) {
-            file << row[i];
-            if (i < row.size() - 1) file << ",";
-        }
-        file << "\n";
+    if (parsedQuery.joinSecondBinaryOperator != NO_BINOP_CLAUSE && (!tableCatalogue.isColumnFromTable(parsedQuery.joinThirdColumnName, parsedQuery.joinFirstRelationName) || !tableCatalogue.isColumnFromTable(parsedQuery.joinFourthColumnName, parsedQuery.joinSecondRelationName)))
+    {
+        cout << "SEMANTIC ERROR: Column doesn't exist in relation" << endl;
+        return false;
     }
-    file.close();
+    return true;
 }
 
-vector<vector<int>> readCSV(const string &filename) {
-    vector<vector<int>> data;
-    ifstream file(filename);
-    string line;
-    while (getline(file, line)) {
-        stringstream ss(line);
-        vector<int> row;
-        string cell;
-        while (getline(ss, cell, ',')) {
-            row.push_back(stoi(cell));
-        }
-        data.push_back(row);
-    }
-    file.close();
-    return data;
-}
 
+/**
+ * @brief One side of a hash join: a table, or a partition file holding the
+ * rows an earlier partitioning pass spilled from one. Partition files hold
+ * packed int32 rows and are written and read a page (rowsPerPage rows) at a
+ * time.
+ */
+struct JoinInput{
+    Table *table = nullptr;
+    string fileName = "";
+    int columnCount = 0;
+    int keyIndex = 0;
+    int rowsPerPage = 0;
+    long long rowCount = 0;
+};
 
+/**
+ * @brief Reads the rows of a JoinInput one after the other: a table through
+ * a cursor, a partition file a page at a time.
+ */
+class JoinInputReader{
+    JoinInput &input;
+    unique_ptr<Cursor> cursor;
+    ifstream fin;
+    vector<int> page;
+    size_t position = 0;
 
-void executeJOIN() {
-    logger.log("executeJOIN");
+    public:
 
-    int num_of_partitions = 10; 
+    JoinInputReader(JoinInput &input) : input(input)
+    {
+        if (input.table && input.table->rowCount > 0)
+            this->cursor = make_unique<Cursor>(input.table->getCursor());
+        else if (!input.table && input.rowCount > 0)
+            this->fin.open(input.fileName, ios::binary);
+    }
 
-    Table *table1 = tableCatalogue.getTable(parsedQuery.joinFirstRelationName);
-    Table *table2 = tableCatalogue.getTable(parsedQuery.joinSecondRelationName);
+    /**
+     * @brief The next row, or an empty view once every row has been read.
+     * The view is valid until the next call.
+     */
+    span<const int> next()
+    {
+        if (this->cursor)
+            return this->cursor->getNextView();
+        if (this->position == this->page.size())
+        {
+            this->page.resize((size_t)this->input.rowsPerPage * this->input.columnCount);
+            this->fin.read((char *)this->page.data(), this->page.size() * sizeof(int));
+            this->page.resize(this->fin.gcount() / sizeof(int));
+            this->position = 0;
+            if (this->page.empty())
+                return span<const int>();
+        }
+        span<const int> row(this->page.data() + this->position, this->input.columnCount);
+        this->position += this->input.columnCount;
+        return row;
+    }
+};
 
-    vector<string> columnNames = table1->columns;
-    columnNames.insert(columnNames.end(), table2->columns.begin(), table2->columns.end());
+// A partition that still does not fit after this many partitioning passes
+// is joined chunk by chunk instead
+const int MAX_JOIN_DEPTH = 8;
 
-    Table *resultantTable = new Table(parsedQuery.joinResultRelationName, columnNames);
-    columnNames.clear();
-
-    int maxRowsPerBlock1 = table1->maxRowsPerBlock;
-    int maxRowsPerBlock2 = table2->maxRowsPerBlock;
+/**
+ * @brief Partition of a join key at a given partitioning pass. Every pass
+ * hashes with a different seed, so repartitioning a partition spreads its
+ * keys over new partitions.
+ *
+ * @param key
+ * @param level
+ * @param partitionCount
+ * @return int
+ */
+static int getJoinPartition(int key, int level, int partitionCount)
+{
+    uint64_t hash = (uint32_t)key + (level + 1) * 0x9E3779B97F4A7C15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+    return (hash ^ (hash >> 31)) % partitionCount;
+}
 
-    vector<int> partitionFileCounters(num_of_partitions, 0);
-    vector<vector<string>> table1PartitionFiles(num_of_partitions);
-    vector<vector<string>> table2PartitionFiles(num_of_partitions);
+/**
+ * @brief Splits a join input into partitionCount partition files by the hash
+ * of the join key. Each partition has a one page buffer that is appended to
+ * its file whenever it fills up.
+ *
+ * @param input
+ * @param partitionCount
+ * @param level
+ * @param filePrefix
+ * @return vector<JoinInput> the partitions; empty ones have no file
+ */
+static vector<JoinInput> partitionJoinInput(JoinInput &input, int partitionCount, int level, string filePrefix)
+{
+    logger.log("partitionJoinInput");
+    vector<JoinInput> partitions(partitionCount);
+    vector<vector<int>> pages(partitionCount);
+    vector<ofstream> files(partitionCount);
+    size_t pageValues = (size_t)input.rowsPerPage * input.columnCount;
+    for (int partitionCounter = 0; partitionCounter < partitionCount; partitionCounter++)
+    {
+        partitions[partitionCounter] = input;
+        partitions[partitionCounter].table = nullptr;
+        partitions[partitionCounter].fileName = filePrefix + "_" + to_string(partitionCounter);
+        partitions[partitionCounter].rowCount = 0;
+        pages[partitionCounter].reserve(pageValues);
+    }
+    auto flushPage = [&](int partition) {
+        if (!files[partition].is_open())
+            files[partition].open(partitions[partition].fileName, ios::binary | ios::trunc);
+        files[partition].write((const char *)pages[partition].data(), pages[partition].size() * sizeof(int));
+        pages[partition].clear();
+    };
+
+    JoinInputReader reader(input);
+    for (span<const int> row = reader.next(); !row.empty(); row = reader.next())
+    {
+        int partition = getJoinPartition(row[input.keyIndex], level, partitionCount);
+        pages[partition].insert(pages[partition].end(), row.begin(), row.end());
+        partitions[partition].rowCount++;
+        if (pages[partition].size() >= pageValues)
+            flushPage(partition);
+    }
+    for (int partitionCounter = 0; partitionCounter < partitionCount; partitionCounter++)
+        if (!pages[partitionCounter].empty())
+            flushPage(partitionCounter);
+    return partitions;
+}
 
-    unordered_map<int, vector<vector<int>>> partitionBuffers1[num_of_partitions];
-    unordered_map<int, vector<vector<int>>> partitionBuffers2[num_of_partitions];
+/**
+ * @brief Joins by loading the build side into an in-memory hash table,
+ * memoryRows rows at a time, and scanning the whole probe side once per
+ * load. A build side that fits takes a single load.
+ *
+ * @param build
+ * @param probe
+ * @param buildIsFirst whether the build rows go first in the result rows
+ * @param memoryRows
+ * @param resultantTable
+ * @param fout
+ */
+static void buildAndProbe(JoinInput &build, JoinInput &probe, bool buildIsFirst, long long memoryRows, Table *resultantTable, ofstream &fout)
+{
+    logger.log("buildAndProbe");
+    JoinInputReader buildReader(build);
+    vector<int> buildRows;
+    unordered_map<int, vector<size_t>> buildTable;
+    vector<int> resultantRow(build.columnCount + probe.columnCount);
+    int buildOffset = buildIsFirst ? 0 : probe.columnCount;
+    int probeOffset = buildIsFirst ? build.columnCount : 0;
+    while (true)
+    {
+        buildRows.clear();
+        buildTable.clear();
+        long long loadedRows = 0;
+        span<const int> buildRow;
+        while (loadedRows < memoryRows && !(buildRow = buildReader.next()).empty())
+        {
+            buildTable[buildRow[build.keyIndex]].push_back(buildRows.size());
+            buildRows.insert(buildRows.end(), buildRow.begin(), buildRow.end());
+            loadedRows++;
+        }
+        if (loadedRows == 0)
+            return;
 
-    int column1Index = table1->getColumnIndex(parsedQuery.joinFirstColumnName);
-    int column2Index = table2->getColumnIndex(parsedQuery.joinSecondColumnName);
+        JoinInputReader probeReader(probe);
+        for (span<const int> probeRow = probeReader.next(); !probeRow.empty(); probeRow = probeReader.next())
+        {
+            auto matches = buildTable.find(probeRow[probe.keyIndex]);
+            if (matches == buildTable.end())
+                continue;
+            copy(probeRow.begin(), probeRow.end(), resultantRow.begin() + probeOffset);
+            for (size_t offset : matches->second)
+            {
+                copy(buildRows.begin() + offset, buildRows.begin() + offset + build.columnCount, resultantRow.begin() + buildOffset);
+                resultantTable->writeRow(span<const int>(resultantRow), fout);
+            }
+        }
+        if (loadedRows < memoryRows)
+            return;
+    }
+}
 
-    // Partitioning phase for table1
-    Cursor cursor1 = table1->getCursor();
-    while (true) {
-        vector<int> row = cursor1.getNext();
-        if (row.empty()) break;
+/**
+ * @brief Grace hash join of two inputs. The smaller input is the build side.
+ * If it fits in the BLOCK_COUNT - 2 pages left over for it (one page is
+ * kept for reading the probe side and one for the output), it is joined in
+ * memory. Otherwise both sides are split into as many partitions as it
+ * takes for a build partition to fit, at most BLOCK_COUNT - 1 so every
+ * partition's page buffer fits in memory, and each pair of partitions is
+ * joined the same way, repartitioning with a new hash seed if needed. A
+ * partition that repartitioning cannot split (a single heavy key) is joined
+ * chunk by chunk.
+ *
+ * @param build
+ * @param probe
+ * @param buildIsFirst whether the build rows go first in the result rows
+ * @param level number of partitioning passes so far
+ * @param resultantTable
+ * @param fout
+ */
+static void hashJoin(JoinInput &build, JoinInput &probe, bool buildIsFirst, int level, Table *resultantTable, ofstream &fout)
+{
+    logger.log("hashJoin");
+    if (build.rowCount == 0 || probe.rowCount == 0)
+        return;
+    if (probe.rowCount * probe.columnCount < build.rowCount * build.columnCount)
+    {
+        hashJoin(probe, build, !buildIsFirst, level, resultantTable, fout);
+        return;
+    }
+    long long memoryRows = (long long)max(1, (int)BLOCK_COUNT - 2) * build.rowsPerPage;
+    if (build.rowCount <= memoryRows || level >= MAX_JOIN_DEPTH)
+    {
+        buildAndProbe(build, probe, buildIsFirst, memoryRows, resultantTable, fout);
+        return;
+    }
 
-        int key = row[column1Index];
-        int partition = hashFunction(key, num_of_partitions);
-        partitionBuffers1[partition][key].push_back(row);
+    int partitionCount = clamp((build.rowCount + memoryRows - 1) / memoryRows, 2LL, (long long)max(2, (int)BLOCK_COUNT - 1));
+    string filePrefix = "../data/temp/" + resultantTable->tableName + "_Join" + to_string(level);
+    vector<JoinInput> buildPartitions = partitionJoinInput(build, partitionCount, level, filePrefix + "_Build");
+    vector<JoinInput> probePartitions = partitionJoinInput(probe, partitionCount, level, filePrefix + "_Probe");
+    for (int partitionCounter = 0; partitionCounter < partitionCount; partitionCounter++)
+    {
+        JoinInput &buildPartition = buildPartitions[partitionCounter];
+        JoinInput &probePartition = probePartitions[partitionCounter];
+        if (buildPartition.rowCount == build.rowCount)
+            buildAndProbe(buildPartition, probePartition, buildIsFirst, memoryRows, resultantTable, fout);
+        else
+            hashJoin(buildPartition, probePartition, buildIsFirst, level + 1, resultantTable, fout);
+        if (buildPartition.rowCount > 0)
+            bufferManager.deleteFile(buildPartition.fileName);
+        if (probePartition.rowCount > 0)
+            bufferManager.deleteFile(probePartition.fileName);
+    }
+}
 
-        if (partitionBuffers1[partition][key].size() >= maxRowsPerBlock1) {
-            logger.log("Writing partition1_" + to_string(partition) + "_" + to_string(partitionFileCounters[partition]));
-            string filename = "../data/temp/partition1_" + to_string(partition) + "_" + to_string(partitionFileCounters[partition]++) + ".csv";
-            table1PartitionFiles[partition].push_back(filename);
-            writeRowsToCSV(filename, partitionBuffers1[partition][key]);
-            partitionBuffers1[partition][key].clear();
+/**
+ * @brief Sort-merge join of two inputs sorted in ascending order of their
+ * join keys. Both are streamed once. The rows of the right input that share
+ * a key are gathered into a run and joined with every left row of that key;
+ * a run larger than BLOCK_COUNT - 2 pages is spilled to a file and read back
+ * for each left row. The result comes out in ascending key order.
+ *
+ * @param left
+ * @param right
+ * @param resultantTable
+ * @param fout
+ */
+static void mergeJoin(JoinInput &left, JoinInput &right, Table *resultantTable, ofstream &fout)
+{
+    logger.log("mergeJoin");
+    JoinInputReader leftReader(left);
+    JoinInputReader rightReader(right);
+    size_t memoryValues = (size_t)max(1, (int)BLOCK_COUNT - 2) * right.rowsPerPage * right.columnCount;
+    JoinInput spilledRun = right;
+    spilledRun.table = nullptr;
+    spilledRun.fileName = "../data/temp/" + resultantTable->tableName + "_MergeRun";
+    vector<int> run;
+    vector<int> resultantRow(left.columnCount + right.columnCount);
+    auto emit = [&](span<const int> rightRow) {
+        copy(rightRow.begin(), rightRow.end(), resultantRow.begin() + left.columnCount);
+        resultantTable->writeRow(span<const int>(resultantRow), fout);
+    };
+
+    span<const int> leftRow = leftReader.next();
+    span<const int> rightRow = rightReader.next();
+    while (!leftRow.empty() && !rightRow.empty())
+    {
+        int key = leftRow[left.keyIndex];
+        if (key < rightRow[right.keyIndex])
+        {
+            leftRow = leftReader.next();
+            continue;
+        }
+        if (rightRow[right.keyIndex] < key)
+        {
+            rightRow = rightReader.next();
+            continue;
         }
-    }
 
-    // Partitioning phase for table2
-    Cursor cursor2 = table2->getCursor();
-    while (true) {
-        vector<int> row = cursor2.getNext();
-        if (row.empty()) break;
-
-        int key = row[column2Index];
-        int partition = hashFunction(key, num_of_partitions);
-        partitionBuffers2[partition][key].push_back(row);
-
-        if (partitionBuffers2[partition][key].size() >= maxRowsPerBlock2) {
-            string filename = "../data/temp/partition2_" + to_string(partition) + "_" + to_string(partitionFileCounters[partition]++) + ".csv";
-            table2PartitionFiles[partition].push_back(filename);
-            writeRowsToCSV(filename, partitionBuffers2[partition][key]);
-            partitionBuffers2[partition][key].clear();
+        // Gather the run of right rows with this key
+        run.clear();
+        spilledRun.rowCount = 0;
+        ofstream spillFile;
+        for (; !rightRow.empty() && rightRow[right.keyIndex] == key; rightRow = rightReader.next())
+        {
+            if (run.size() >= memoryValues)
+            {
+                if (!spillFile.is_open())
+                    spillFile.open(spilledRun.fileName, ios::binary | ios::trunc);
+                spillFile.write((const char *)run.data(), run.size() * sizeof(int));
+                run.clear();
+            }
+            run.insert(run.end(), rightRow.begin(), rightRow.end());
+            spilledRun.rowCount++;
+        }
+        bool spilled = spillFile.is_open();
+        if (spilled)
+        {
+            spillFile.write((const char *)run.data(), run.size() * sizeof(int));
+            spillFile.close();
         }
-    }
 
-    for (int p = 0; p < num_of_partitions; ++p) {
-        for (auto &buffer : partitionBuffers1[p]) {
-            if (!buffer.second.empty()) {
-                logger.log("Writing partition1_" + to_string(p) + "_" + to_string(partitionFileCounters[p]));
-                string filename = "../data/temp/partition1_" + to_string(p) + "_" + to_string(partitionFileCounters[p]++) + ".csv";
-                table1PartitionFiles[p].push_back(filename);
-                writeRowsToCSV(filename, buffer.second);
+        for (; !leftRow.empty() && leftRow[left.keyIndex] == key; leftRow = leftReader.next())
+        {
+            copy(leftRow.begin(), leftRow.end(), resultantRow.begin());
+            if (!spilled)
+                for (size_t offset = 0; offset < run.size(); offset += right.columnCount)
+                    emit(span<const int>(run.data() + offset, right.columnCount));
+            else
+            {
+                JoinInputReader runReader(spilledRun);
+                for (span<const int> runRow = runReader.next(); !runRow.empty(); runRow = runReader.next())
+                    emit(runRow);
             }
         }
+        if (spilled)
+            bufferManager.deleteFile(spilledRun.fileName);
     }
+}
+
+/**
+ * @brief Index nested-loop join of an outer input with a table that has a
+ * secondary index on its join column. The outer input is read in chunks of
+ * BLOCK_COUNT - 2 pages and every distinct key of a chunk is looked up once
+ * in the index. The (page, row) pointers of all the matches of a chunk are
+ * then sorted, so every inner page holding a match is fetched once per chunk
+ * and in page order, and pages without matches are not read at all.
+ *
+ * @param outer
+ * @param inner the indexed table
+ * @param outerIsFirst whether the outer rows go first in the result rows
+ * @param resultantTable
+ * @param fout
+ */
+static void indexJoin(JoinInput &outer, JoinInput &inner, bool outerIsFirst, Table *resultantTable, ofstream &fout)
+{
+    logger.log("indexJoin");
+    SecondaryIndex index(inner.table->tableName, inner.table->columns[inner.keyIndex]);
+    index.readIndex();
+    JoinInputReader outerReader(outer);
+    long long memoryRows = (long long)max(1, (int)BLOCK_COUNT - 2) * outer.rowsPerPage;
+    vector<int> outerRows;
+    unordered_map<int, vector<pair<int, int>>> matchesByKey;
+    // (inner page, inner row, offset of the outer row in outerRows)
+    vector<tuple<int, int, size_t>> probes;
+    vector<int> resultantRow(outer.columnCount + inner.columnCount);
+    int outerOffset = outerIsFirst ? 0 : inner.columnCount;
+    int innerOffset = outerIsFirst ? outer.columnCount : 0;
+    while (true)
+    {
+        outerRows.clear();
+        matchesByKey.clear();
+        probes.clear();
+        long long loadedRows = 0;
+        span<const int> outerRow;
+        while (loadedRows < memoryRows && !(outerRow = outerReader.next()).empty())
+        {
+            loadedRows++;
+            int key = outerRow[outer.keyIndex];
+            auto matches = matchesByKey.find(key);
+            if (matches == matchesByKey.end())
+                matches = matchesByKey.emplace(key, index.search(key)).first;
+            if (matches->second.empty())
+                continue;
+            for (auto &[pageIndex, rowIndex] : matches->second)
+                probes.emplace_back(pageIndex, rowIndex, outerRows.size());
+            outerRows.insert(outerRows.end(), outerRow.begin(), outerRow.end());
+        }
+        if (loadedRows == 0)
+            return;
 
-    for (int p = 0; p < num_of_partitions; ++p) {
-        for (auto &buffer : partitionBuffers2[p]) {
-            if (!buffer.second.empty()) {
-                string filename = "../data/temp/partition2_" + to_string(p) + "_" + to_string(partitionFileCounters[p]++) + ".csv";
-                table2PartitionFiles[p].push_back(filename);
-                writeRowsToCSV(filename, buffer.second);
+        sort(probes.begin(), probes.end());
+        PageHandle page;
+        int currentPageIndex = -1;
+        for (auto &[pageIndex, rowIndex, offset] : probes)
+        {
+            if (pageIndex != currentPageIndex)
+            {
+                if (pageIndex < 0 || pageIndex >= (int)inner.table->blockCount)
+                    continue;
+                page = bufferManager.getPage(inner.table->tableName, pageIndex);
+                currentPageIndex = pageIndex;
             }
+            // Skip pointers the index kept for rows that have since changed
+            if (rowIndex < 0 || rowIndex >= page->getRowCount() || page->getValue(rowIndex, inner.keyIndex) != outerRows[offset + outer.keyIndex])
+                continue;
+            copy(outerRows.begin() + offset, outerRows.begin() + offset + outer.columnCount, resultantRow.begin() + outerOffset);
+            page->copyRow(rowIndex, {}, resultantRow.data() + innerOffset);
+            resultantTable->writeRow(span<const int>(resultantRow), fout);
         }
+        if (loadedRows < memoryRows)
+            return;
     }
+}
+
+/**
+ * @brief One condition of a theta join, "outer[outerColumn] OP
+ * inner[innerColumn]", written with the outer table on the left.
+ */
+struct JoinCondition{
+    int outerColumn;
+    int innerColumn;
+    BinaryOperator binaryOperator;
+};
+
+static bool isInequality(BinaryOperator binaryOperator)
+{
+    return binaryOperator == LESS_THAN || binaryOperator == GREATER_THAN || binaryOperator == LEQ || binaryOperator == GEQ;
+}
 
-    // Clear partition buffers
-    for (int p = 0; p < num_of_partitions; ++p) {
-        partitionBuffers1[p].clear();
-        partitionBuffers2[p].clear();
+/**
+ * @brief Join of two tables on a conjunction of conditions "column1 OP
+ * column2", column1 of table1 and column2 of table2.
+ *
+ * <p>
+ * This is a block nested-loop join: the outer table is read in chunks of
+ * BLOCK_COUNT - 2 pages and the inner table is streamed once per chunk, a
+ * batch at a time. For every outer row of the chunk the predicate kernels
+ * test each condition down a column of the inner batch and the bitmaps are
+ * intersected.
+ * </p>
+ * <p>
+ * When every condition is an inequality on the same outer column (a band
+ * join such as "ts >= start AND ts <= end", or a single inequality), each
+ * chunk is sorted on that column instead. The outer rows matching an inner
+ * row then form a contiguous range of the chunk, found by binary search,
+ * so the work per inner row no longer grows with the chunk.
+ * </p>
+ * <p>
+ * The smaller table is the outer one, unless only the other one can make
+ * the join a band join. The result is not sorted.
+ * </p>
+ *
+ * @param table1
+ * @param table2
+ * @param columnPairs the (table1, table2) column indices of each condition
+ * @param binaryOperators the operator of each condition
+ * @param resultantTable
+ * @param fout
+ */
+static void thetaJoin(Table *table1, Table *table2, vector<pair<int, int>> columnPairs, vector<BinaryOperator> binaryOperators, Table *resultantTable, ofstream &fout)
+{
+    logger.log("thetaJoin");
+    bool inequalities = all_of(binaryOperators.begin(), binaryOperators.end(), isInequality);
+    bool firstShared = all_of(columnPairs.begin(), columnPairs.end(), [&](pair<int, int> &columns) { return columns.first == columnPairs.front().first; });
+    bool secondShared = all_of(columnPairs.begin(), columnPairs.end(), [&](pair<int, int> &columns) { return columns.second == columnPairs.front().second; });
+    bool outerIsFirst = table1->blockCount <= table2->blockCount;
+    if (inequalities && firstShared != secondShared)
+        outerIsFirst = firstShared;
+    bool band = inequalities && (outerIsFirst ? firstShared : secondShared);
+
+    Table *outer = outerIsFirst ? table1 : table2;
+    Table *inner = outerIsFirst ? table2 : table1;
+    vector<JoinCondition> conditions;
+    for (size_t conditionCounter = 0; conditionCounter < columnPairs.size(); conditionCounter++)
+    {
+        pair<int, int> &columns = columnPairs[conditionCounter];
+        if (outerIsFirst)
+            conditions.push_back({columns.first, columns.second, binaryOperators[conditionCounter]});
+        else
+            conditions.push_back({columns.second, columns.first, flipBinaryOperator(binaryOperators[conditionCounter])});
     }
+    if (outer->rowCount == 0 || inner->rowCount == 0)
+        return;
 
-    for (int p = 0; p < num_of_partitions; ++p) {
-        if (table1PartitionFiles[p].empty() || table2PartitionFiles[p].empty()) continue;
-        for (const auto &file1 : table1PartitionFiles[p]) {
-            // Read one block at a time from table1
-            vector<vector<int>> blockTable1 = readCSV(file1);
-            
-            // Create a hash table for this block
-            unordered_map<int, vector<vector<int>>> blockHashTable;
-            for (const auto &row : blockTable1) {
-                int key = row[column1Index];
-                blockHashTable[key].push_back(row);
+    JoinInput outerInput;
+    outerInput.table = outer;
+    outerInput.columnCount = outer->columnCount;
+    outerInput.rowsPerPage = outer->maxRowsPerBlock;
+    outerInput.rowCount = outer->rowCount;
+    JoinInputReader outerReader(outerInput);
+    long long memoryRows = (long long)max(1, (int)BLOCK_COUNT - 2) * outer->maxRowsPerBlock;
+    int outerColumnCount = outer->columnCount;
+    vector<int> chunk, sortedChunk, chunkKeys;
+    vector<int> resultantRow(outer->columnCount + inner->columnCount);
+    int outerOffset = outerIsFirst ? 0 : inner->columnCount;
+    int innerOffset = outerIsFirst ? outer->columnCount : 0;
+    RowBatch batch;
+    uint64_t bitmap[BATCH_SIZE / 64];
+    uint64_t conditionBitmap[BATCH_SIZE / 64];
+    auto emit = [&](const int *outerRow, int innerRowIndex) {
+        copy(outerRow, outerRow + outerColumnCount, resultantRow.begin() + outerOffset);
+        batch.copyRow(innerRowIndex, resultantRow.data() + innerOffset);
+        resultantTable->writeRow(span<const int>(resultantRow), fout);
+    };
+
+    while (true)
+    {
+        chunk.clear();
+        long long chunkRows = 0;
+        span<const int> outerRow;
+        while (chunkRows < memoryRows && !(outerRow = outerReader.next()).empty())
+        {
+            chunk.insert(chunk.end(), outerRow.begin(), outerRow.end());
+            chunkRows++;
+        }
+        if (chunkRows == 0)
+            return;
+
+        if (band)
+        {
+            int keyColumn = conditions.front().outerColumn;
+            vector<int> order(chunkRows);
+            iota(order.begin(), order.end(), 0);
+            stable_sort(order.begin(), order.end(), [&](int row1, int row2) {
+                return chunk[(size_t)row1 * outerColumnCount + keyColumn] < chunk[(size_t)row2 * outerColumnCount + keyColumn];
+            });
+            sortedChunk.resize(chunk.size());
+            chunkKeys.resize(chunkRows);
+            for (long long rowCounter = 0; rowCounter < chunkRows; rowCounter++)
+            {
+                copy_n(chunk.begin() + (size_t)order[rowCounter] * outerColumnCount, outerColumnCount, sortedChunk.begin() + (size_t)rowCounter * outerColumnCount);
+                chunkKeys[rowCounter] = sortedChunk[(size_t)rowCounter * outerColumnCount + keyColumn];
             }
+            chunk.swap(sortedChunk);
+        }
 
-            // Process each block from table2 in the current partition
-            for (const auto &file2 : table2PartitionFiles[p]) 
+        Cursor cursor = inner->getCursor();
+        while (cursor.nextBatch(batch))
+        {
+            if (band)
             {
-                vector<vector<int>> blockTable2 = readCSV(file2);
-                
-                for (const auto &row2 : blockTable2) 
+                for (int innerRowIndex = 0; innerRowIndex < batch.rowCount; innerRowIndex++)
                 {
-                    int key = row2[column2Index];
-                    
-                    // Check if key exists in the current block's hash table and join
-                    if (blockHashTable.find(key) != blockHashTable.end()) 
+                    auto first = chunkKeys.begin();
+                    auto last = chunkKeys.end();
+                    for (JoinCondition &condition : conditions)
                     {
-                        for (auto &row1 : blockHashTable[key]) 
-                        {
-                            vector<int> newRow = row1;
-                            newRow.insert(newRow.end(), row2.begin(), row2.end());
-                            resultantTable->writeRow<int>(newRow);
-                        }
+                        int value = batch.getValue(innerRowIndex, condition.innerColumn);
+                        if (condition.binaryOperator == LESS_THAN)
+                            last = min(last, lower_bound(chunkKeys.begin(), chunkKeys.end(), value));
+                        else if (condition.binaryOperator == LEQ)
+                            last = min(last, upper_bound(chunkKeys.begin(), chunkKeys.end(), value));
+                        else if (condition.binaryOperator == GREATER_THAN)
+                            first = max(first, upper_bound(chunkKeys.begin(), chunkKeys.end(), value));
+                        else
+                            first = max(first, lower_bound(chunkKeys.begin(), chunkKeys.end(), value));
                     }
+                    for (auto match = first; match < last; match++)
+                        emit(chunk.data() + (size_t)(match - chunkKeys.begin()) * outerColumnCount, innerRowIndex);
                 }
+                continue;
+            }
+            int wordCount = getBitmapWordCount(batch.rowCount);
+            for (long long rowCounter = 0; rowCounter < chunkRows; rowCounter++)
+            {
+                const int *chunkRow = chunk.data() + (size_t)rowCounter * outerColumnCount;
+                for (size_t conditionCounter = 0; conditionCounter < conditions.size(); conditionCounter++)
+                {
+                    JoinCondition &condition = conditions[conditionCounter];
+                    // outer OP inner is inner flip(OP) outer
+                    uint64_t *target = conditionCounter == 0 ? bitmap : conditionBitmap;
+                    evaluatePredicate(batch.getColumn(condition.innerColumn), flipBinaryOperator(condition.binaryOperator), chunkRow[condition.outerColumn], target);
+                    if (conditionCounter > 0)
+                        for (int wordCounter = 0; wordCounter < wordCount; wordCounter++)
+                            bitmap[wordCounter] &= conditionBitmap[wordCounter];
+                }
+                forEachSelectedRow(bitmap, batch.rowCount, [&](int innerRowIndex) {
+                    emit(chunkRow, innerRowIndex);
+                });
             }
         }
+        if (chunkRows < memoryRows)
+            return;
     }
-    
-    // Delete temporary files
-    for (int p = 0; p < num_of_partitions; ++p) {
-        for (const auto &file : table1PartitionFiles[p]) {
-            if (remove(file.c_str()) != 0) {
-                logger.log("Error deleting temporary file: " + file);
-            }
+}
+
+/**
+ * @brief Join of two tables. An equi-join's result is sorted on the join
+ * columns; other joins are run by thetaJoin.
+ *
+ * <p>
+ * If the catalogue knows either table to be sorted on its join column, the
+ * other one is sorted too (with ORDER BY, into a temporary table) unless it
+ * already is, and the two are merged (see mergeJoin); the merged result is
+ * already in order. Otherwise the tables are hash joined (see hashJoin) and
+ * the result is sorted afterwards.
+ * </p>
+ */
+void executeJOIN()
+{
+    logger.log("executeJOIN");
+
+    Table *table1 = tableCatalogue.getTable(parsedQuery.joinFirstRelationName);
+    Table *table2 = tableCatalogue.getTable(parsedQuery.joinSecondRelationName);
+
+    vector<string> columnNames = table1->columns;
+    columnNames.insert(columnNames.end(), table2->columns.begin(), table2->columns.end());
+    Table *resultantTable = new Table(parsedQuery.joinResultRelationName, columnNames);
+
+    JoinInput input1, input2;
+    input1.table = table1;
+    input1.columnCount = table1->columnCount;
+    input1.keyIndex = table1->getColumnIndex(parsedQuery.joinFirstColumnName);
+    input1.rowsPerPage = table1->maxRowsPerBlock;
+    input1.rowCount = table1->rowCount;
+    input2.table = table2;
+    input2.columnCount = table2->columnCount;
+    input2.keyIndex = table2->getColumnIndex(parsedQuery.joinSecondColumnName);
+    input2.rowsPerPage = table2->maxRowsPerBlock;
+    input2.rowCount = table2->rowCount;
+
+    ofstream fout(resultantTable->sourceFileName, ios::app);
+    if (parsedQuery.joinBinaryOperator != EQUAL || parsedQuery.joinSecondBinaryOperator != NO_BINOP_CLAUSE)
+    {
+        vector<pair<int, int>> columnPairs = {{input1.keyIndex, input2.keyIndex}};
+        vector<BinaryOperator> binaryOperators = {parsedQuery.joinBinaryOperator};
+        if (parsedQuery.joinSecondBinaryOperator != NO_BINOP_CLAUSE)
+        {
+            columnPairs.emplace_back(table1->getColumnIndex(parsedQuery.joinThirdColumnName), table2->getColumnIndex(parsedQuery.joinFourthColumnName));
+            binaryOperators.push_back(parsedQuery.joinSecondBinaryOperator);
         }
+        thetaJoin(table1, table2, columnPairs, binaryOperators, resultantTable, fout);
+        fout.close();
 
-        for (const auto &file : table2PartitionFiles[p]) 
+        resultantTable->blockify();
+        tableCatalogue.insertTable(resultantTable);
+        resultantTable->print();
+        return;
+    }
+    // Probe the index of the larger table with the rows of the smaller one
+    // when the larger table has a secondary index on its join column
+    bool indexed1 = filesystem::exists("../data/indices/" + table1->tableName + "_" + parsedQuery.joinFirstColumnName + "_Indexfile_0");
+    bool indexed2 = filesystem::exists("../data/indices/" + table2->tableName + "_" + parsedQuery.joinSecondColumnName + "_Indexfile_0");
+    if ((indexed2 && input1.rowCount <= input2.rowCount) || (indexed1 && input2.rowCount < input1.rowCount))
+    {
+        bool outerIsFirst = indexed2 && input1.rowCount <= input2.rowCount;
+        SecondaryIndex::refreshIndexes(outerIsFirst ? table2->tableName : table1->tableName);
+        if (outerIsFirst)
+            indexJoin(input1, input2, true, resultantTable, fout);
+        else
+            indexJoin(input2, input1, false, resultantTable, fout);
+        fout.close();
+
+        resultantTable->blockify();
+        tableCatalogue.insertTable(resultantTable);
+        ExternalSort externalsort(resultantTable, {parsedQuery.joinFirstColumnName, parsedQuery.joinSecondColumnName}, {true, true});
+        externalsort.performExternalSort();
+        return;
+    }
+    bool sorted1 = table1->isSortedOn(parsedQuery.joinFirstColumnName);
+    bool sorted2 = table2->isSortedOn(parsedQuery.joinSecondColumnName);
+    if ((sorted1 || sorted2) && input1.rowCount > 0 && input2.rowCount > 0)
+    {
+        // Sort whichever input is not sorted yet
+        vector<string> sortedInputs;
+        for (JoinInput *input : {&input1, &input2})
         {
-            if (remove(file.c_str()) != 0) 
-            {
-                logger.log("Error deleting temporary file: " + file);
-            }
+            if (input->table->isSortedOn(input->table->columns[input->keyIndex]))
+                continue;
+            string sortedInputName = parsedQuery.joinResultRelationName + "_MergeInput" + to_string(sortedInputs.size());
+            ExternalSort externalsort(input->table, {}, {});
+            externalsort.performOrderBy(sortedInputName, input->table->columns[input->keyIndex], true);
+            input->table = tableCatalogue.getTable(sortedInputName);
+            sortedInputs.push_back(sortedInputName);
         }
+        mergeJoin(input1, input2, resultantTable, fout);
+        fout.close();
+        for (string &sortedInputName : sortedInputs)
+            tableCatalogue.deleteTable(sortedInputName);
+
+        resultantTable->blockify();
+        resultantTable->sortColumns = {parsedQuery.joinFirstColumnName, parsedQuery.joinSecondColumnName};
+        resultantTable->sortDirections = {true, true};
+        tableCatalogue.insertTable(resultantTable);
+        resultantTable->print();
+        return;
     }
-    
+    hashJoin(input1, input2, true, 0, resultantTable, fout);
+    fout.close();
+
     resultantTable->blockify();
     tableCatalogue.insertTable(resultantTable);
     // Sort the resultant table
     ExternalSort externalsort(resultantTable,{parsedQuery.joinFirstColumnName,parsedQuery.joinSecondColumnName},{true,true});
     externalsort.performExternalSort();
 }
-
-
-
@@ -1,18 +1,30 @@
 #include "global.h"
 /**
  * @brief 
- * SYNTAX: LOAD relation_name
+ * SYNTAX: LOAD relation_name [USING ROW|PAX]
  */
 bool syntacticParseLOAD()
 {
     logger.log("syntacticParseLOAD");
-    if (tokenizedQuery.size() != 2)
+    if (tokenizedQuery.size() != 2 && (tokenizedQuery.size() != 4 || tokenizedQuery[2] != "USING"))
     {
         cout << "SYNTAX ERROR" << endl;
         return false;
     }
     parsedQuery.queryType = LOAD;
     parsedQuery.loadRelationName = tokenizedQuery[1];
+    if (tokenizedQuery.size() == 4)
+    {
+        if (tokenizedQuery[3] == "PAX")
+            parsedQuery.loadLayout = PAX;
+        else if (tokenizedQuery[3] == "ROW")
+            parsedQuery.loadLayout = ROW_MAJOR;
+        else
+        {
+            cout << "SYNTAX ERROR" << endl;
+            return false;
+        }
+    }
     return true;
 }
 
@@ -38,6 +50,7 @@ void executeLOAD()
     logger.log("executeLOAD");
 
     Table *table = new Table(parsedQuery.loadRelationName);
+    table->layout = parsedQuery.loadLayout;
     if (table->load())
     {
         tableCatalogue.insertTable(table);
@@ -0,0 +1,29 @@
+#include "global.h"
+/**
+ * @brief 
+ * SYNTAX: PRINT BUFFER
+ */
+bool syntacticParsePRINTBUFFER()
+{
+    logger.log("syntacticParsePRINTBUFFER");
+    if (tokenizedQuery.size() != 2)
+    {
+        cout << "SYNTAX ERROR" << endl;
+        return false;
+    }
+    parsedQuery.queryType = PRINT_BUFFER;
+    return true;
+}
+
+bool semanticParsePRINTBUFFER()
+{
+    logger.log("semanticParsePRINTBUFFER");
+    return true;
+}
+
+void executePRINTBUFFER()
+{
+    logger.log("executePRINTBUFFER");
+    bufferManager.printStatistics();
+    return;
+}
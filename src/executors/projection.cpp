@@ -67,25 +67,25 @@ void executePROJECTION()
     logger.log("executePROJECTION");
     Table* resultantTable = new Table(parsedQuery.projectionResultRelationName, parsedQuery.projectionColumnList);
     Table table = *tableCatalogue.getTable(parsedQuery.projectionRelationName);
-    Cursor cursor = table.getCursor();
     vector<int> columnIndices;
     for (int columnCounter = 0; columnCounter < parsedQuery.projectionColumnList.size(); columnCounter++)
     {
         columnIndices.emplace_back(table.getColumnIndex(parsedQuery.projectionColumnList[columnCounter]));
     }
-    vector<int> row = cursor.getNext();
+    Cursor cursor = table.getCursor(columnIndices);
+    RowBatch batch;
     vector<int> resultantRow(columnIndices.size(), 0);
+    ofstream fout(resultantTable->sourceFileName, ios::app);
 
-    while (!row.empty())
+    while (cursor.nextBatch(batch))
     {
-
-        for (int columnCounter = 0; columnCounter < columnIndices.size(); columnCounter++)
+        for (int rowCounter = 0; rowCounter < batch.rowCount; rowCounter++)
         {
-            resultantRow[columnCounter] = row[columnIndices[columnCounter]];
+            batch.copyRow(rowCounter, resultantRow.data());
+            resultantTable->writeRow<int>(resultantRow, fout);
         }
-        resultantTable->writeRow<int>(resultantRow);
-        row = cursor.getNext();
     }
+    fout.close();
     resultantTable->blockify();
     tableCatalogue.insertTable(resultantTable);
     return;
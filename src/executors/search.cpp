@@ -126,29 +126,46 @@ void executeSEARCH()
     return;
   }
 
-  // Check if secondary index exists for this column, create if not
-  SecondaryIndex *indexObj = nullptr;
+  // Check if secondary index exists for this column
+  SecondaryIndex::refreshIndexes(sourceRelation);
   string indexFileName = "../data/indices/" + sourceRelation + "_" + columnName + "_Indexfile_0";
   ifstream indexFile(indexFileName);
 
   if (!indexFile)
   {
-    logger.log("Creating secondary index for " + sourceRelation + "." + columnName);
-    indexObj = new SecondaryIndex(sourceRelation, columnName);
-    if (!indexObj->createIndex())
+    // Without an index the table is scanned batch by batch; the predicate
+    // kernels mark matching rows, which come out in table order
+    logger.log("No secondary index for " + sourceRelation + "." + columnName + ". Using linear scan.");
+    Table *resultTable = new Table(resultRelation, sourceTable->getColumnNames());
+    Cursor cursor = sourceTable->getCursor();
+    RowBatch batch;
+    BinaryOperator binaryOperator = parseBinaryOperator(searchOperator);
+    cursor.setPageFilter(getZoneFilter(sourceTable, columnIndex, binaryOperator, searchValue));
+    uint64_t bitmap[BATCH_SIZE / 64];
+    vector<int> row(sourceTable->columnCount);
+    int matchingRowsCount = 0;
+    ofstream fout(resultTable->sourceFileName, ios::app);
+    while (cursor.nextBatch(batch))
     {
-      cout << "ERROR: Failed to create secondary index" << endl;
-      delete indexObj;
-      return;
+      evaluatePredicate(batch.getColumn(columnIndex), binaryOperator, searchValue, bitmap);
+      forEachSelectedRow(bitmap, batch.rowCount, [&](int rowCounter) {
+        batch.copyRow(rowCounter, row.data());
+        resultTable->writeRow<int>(row, fout);
+        matchingRowsCount++;
+      });
     }
+    fout.close();
+    resultTable->blockify();
+    tableCatalogue.insertTable(resultTable);
+
+    cout << "SEARCH RESULT: " << matchingRowsCount << " rows matching the condition." << endl;
+    return;
   }
-  else
-  {
-    indexFile.close();
-    logger.log("Using existing secondary index for " + sourceRelation + "." + columnName);
-    indexObj = new SecondaryIndex(sourceRelation, columnName);
-    indexObj->readIndex();
-  }
+
+  indexFile.close();
+  logger.log("Using existing secondary index for " + sourceRelation + "." + columnName);
+  SecondaryIndex *indexObj = new SecondaryIndex(sourceRelation, columnName);
+  indexObj->readIndex();
 
   // Create result table with same schema as source table
   vector<string> columns = sourceTable->getColumnNames();
@@ -177,14 +194,16 @@ void executeSEARCH()
     bpFile >> recordCount;
 
     // Process each record pointer
+    vector<int> row;
     for (int i = 0; i < recordCount; i++)
     {
       int pageNo, recordNo;
       bpFile >> pageNo >> recordNo;
 
       // Get the actual row from the source table
-      Page page = bufferManager.getPage(sourceRelation, pageNo);
-      vector<int> row = page.getRow(recordNo);
+      PageHandle page = bufferManager.getPage(sourceRelation, pageNo);
+      row.resize(page->getColumnCount());
+      page->copyRow(recordNo, {}, row.data());
 
       // Add row to result table
       resultTable->writeRow<int>(row);
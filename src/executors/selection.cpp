@@ -110,24 +110,31 @@ void executeSELECTION()
     Table table = *tableCatalogue.getTable(parsedQuery.selectionRelationName);
     Table* resultantTable = new Table(parsedQuery.selectionResultRelationName, table.columns);
     Cursor cursor = table.getCursor();
-    vector<int> row = cursor.getNext();
+    RowBatch batch;
     int firstColumnIndex = table.getColumnIndex(parsedQuery.selectionFirstColumnName);
+    if (parsedQuery.selectType == INT_LITERAL)
+        cursor.setPageFilter(getZoneFilter(&table, firstColumnIndex, parsedQuery.selectionBinaryOperator, parsedQuery.selectionIntLiteral));
     int secondColumnIndex;
     if (parsedQuery.selectType == COLUMN)
         secondColumnIndex = table.getColumnIndex(parsedQuery.selectionSecondColumnName);
-    while (!row.empty())
+    vector<int> row(table.columnCount);
+    uint64_t bitmap[BATCH_SIZE / 64];
+    ofstream fout(resultantTable->sourceFileName, ios::app);
+    // The predicate runs down the columns of a batch and marks the rows that
+    // qualify; only those are gathered back into a row
+    while (cursor.nextBatch(batch))
     {
-
-        int value1 = row[firstColumnIndex];
-        int value2;
+        span<const int> firstColumn = batch.getColumn(firstColumnIndex);
         if (parsedQuery.selectType == INT_LITERAL)
-            value2 = parsedQuery.selectionIntLiteral;
+            evaluatePredicate(firstColumn, parsedQuery.selectionBinaryOperator, parsedQuery.selectionIntLiteral, bitmap);
         else
-            value2 = row[secondColumnIndex];
-        if (evaluateBinOp(value1, value2, parsedQuery.selectionBinaryOperator))
-            resultantTable->writeRow<int>(row);
-        row = cursor.getNext();
+            evaluatePredicate(firstColumn, batch.getColumn(secondColumnIndex), parsedQuery.selectionBinaryOperator, bitmap);
+        forEachSelectedRow(bitmap, batch.rowCount, [&](int rowCounter) {
+            batch.copyRow(rowCounter, row.data());
+            resultantTable->writeRow<int>(row, fout);
+        });
     }
+    fout.close();
     if(resultantTable->blockify())
         tableCatalogue.insertTable(resultantTable);
     else{
@@ -0,0 +1,37 @@
+#include "global.h"
+/**
+ * @brief 
+ * SYNTAX: SET BUFFER POLICY <FIFO|LRU|CLOCK|LRU-K|2Q>
+ */
+bool syntacticParseSETBUFFERPOLICY()
+{
+    logger.log("syntacticParseSETBUFFERPOLICY");
+    if (tokenizedQuery.size() != 4 || tokenizedQuery[1] != "BUFFER" || tokenizedQuery[2] != "POLICY")
+    {
+        cout << "SYNTAX ERROR" << endl;
+        return false;
+    }
+    parsedQuery.queryType = SET_BUFFER_POLICY;
+    parsedQuery.bufferPolicyName = tokenizedQuery[3];
+    return true;
+}
+
+bool semanticParseSETBUFFERPOLICY()
+{
+    logger.log("semanticParseSETBUFFERPOLICY");
+    unique_ptr<ReplacementPolicy> policy(createReplacementPolicy(parsedQuery.bufferPolicyName));
+    if (!policy)
+    {
+        cout << "SEMANTIC ERROR: Unknown buffer policy. Use FIFO, LRU, CLOCK, LRU-K or 2Q" << endl;
+        return false;
+    }
+    return true;
+}
+
+void executeSETBUFFERPOLICY()
+{
+    logger.log("executeSETBUFFERPOLICY");
+    bufferManager.setPolicy(parsedQuery.bufferPolicyName);
+    cout << "Buffer policy: " << bufferManager.getPolicyName() << endl;
+    return;
+}
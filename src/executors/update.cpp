@@ -114,6 +114,7 @@ void executeUPDATE()
     int newVal = parsedQuery.updateTargetValue;
 
     // Check secondary index on condition column
+    SecondaryIndex::refreshIndexes(tableName);
     string condIndexFile = "../data/indices/" + tableName + "_" + parsedQuery.updateConditionColumnName + "_Indexfile_0";
     ifstream condIdxCheck(condIndexFile);
     bool condIndexExists = condIdxCheck.good();
@@ -122,6 +123,14 @@ void executeUPDATE()
     // Track updated rows count
     int updatedCount = 0;
 
+    // An updated row can leave the zone map of its page; the zone is widened
+    // to cover it, so it stays correct until ANALYZE tightens it
+    vector<int> updatedRow(table->columnCount);
+    auto widenZoneMap = [&](int pageNo, PageHandle &page, int recNo) {
+        page->copyRow(recNo, {}, updatedRow.data());
+        table->widenZoneMap(pageNo, updatedRow);
+    };
+
     // Gather record locations to update
     vector<pair<int,int>> records;
     if (condIndexExists)
@@ -152,60 +161,57 @@ void executeUPDATE()
             int pageNo = loc.first;
             int recNo  = loc.second;
 
-            Page page = bufferManager.getPage(tableName, pageNo);
-            vector<int> row = page.getRow(recNo);
-            row[targetColIdx] = newVal;
-            page.updateRow(recNo, row);
-            // bufferManager.writePage(tableName, pageNo, page);
-            bufferManager.writePage(
-                tableName,
-                pageNo,
-                page.getRows(),
-                page.getRowCount()
-            );
-            
-
+            PageHandle page = bufferManager.getPage(tableName, pageNo);
+            page->setValue(recNo, targetColIdx, newVal);
+            widenZoneMap(pageNo, page, recNo);
             updatedCount++;
         }
     }
     else
     {
-        // Linear scan: iterate through all pages
+        // Linear scan: iterate through all pages the zone maps do not rule
+        // out. The condition column of a page is tested in one pass and only
+        // the marked rows are rewritten
+        BinaryOperator binaryOperator = parseBinaryOperator(condOp);
+        function<bool(int)> zoneFilter = getZoneFilter(table, condColIdx, binaryOperator, condVal);
+        vector<int> column;
+        vector<uint64_t> bitmap;
         int numPages = table->getNumPages();
         for (int p = 0; p < numPages; ++p)
         {
-            Page page = bufferManager.getPage(tableName, p);
-            int numRecs = page.getNumRecords();
-            for (int r = 0; r < numRecs; ++r)
+            if (!zoneFilter(p))
+                continue;
+            PageHandle page = bufferManager.getPage(tableName, p);
+            int numRecs = page->getNumRecords();
+            span<const int> condColumn;
+            if (page->getLayout() == PAX)
+                condColumn = page->getColumnView(condColIdx);
+            else
             {
-                vector<int> row = page.getRow(r);
-                bool match = false;
-                int field = row[condColIdx];
-                if (condOp == "==") match = (field == condVal);
-                else if (condOp == "!=") match = (field != condVal);
-                else if (condOp == "<")  match = (field < condVal);
-                else if (condOp == "<=") match = (field <= condVal);
-                else if (condOp == ">")  match = (field > condVal);
-                else if (condOp == ">=") match = (field >= condVal);
-
-                if (match)
-                {
-                    row[targetColIdx] = newVal;
-                    page.updateRow(r, row);
-                    updatedCount++;
-                }
+                column.resize(numRecs);
+                for (int r = 0; r < numRecs; ++r)
+                    column[r] = page->getValue(r, condColIdx);
+                condColumn = column;
             }
-            // bufferManager.writePage(tableName, p, page);
-            bufferManager.writePage(
-                tableName,
-                p,
-                page.getRows(),
-                page.getRowCount()
-            );
-            
+            bitmap.resize(getBitmapWordCount(numRecs));
+            evaluatePredicate(condColumn, binaryOperator, condVal, bitmap.data());
+            forEachSelectedRow(bitmap.data(), numRecs, [&](int r) {
+                page->setValue(r, targetColIdx, newVal);
+                widenZoneMap(p, page, r);
+                updatedCount++;
+            });
         }
     }
 
+    // Rows were changed in the cached frames; write each dirty page back once
+    bufferManager.flush(tableName);
+    if (updatedCount > 0 && find(table->sortColumns.begin(), table->sortColumns.end(), parsedQuery.updateTargetColumnName) != table->sortColumns.end())
+    {
+        table->sortColumns.clear();
+        table->sortDirections.clear();
+    }
+    table->writeSegmentHeader();
+
     // Rebuild secondary index on target column if it existed before
     string targetIndexFile = "../data/indices/" + tableName + "_" + parsedQuery.updateTargetColumnName + "_Indexfile_0";
     ifstream targetIdxCheck(targetIndexFile);
@@ -216,9 +222,6 @@ void executeUPDATE()
         newIdx.createIndex();
     }
 
-    // Clear buffer pool to flush all changes
-    bufferManager.clearPool();
-
     // Print summary
     if (updatedCount > 0)
         cout << "Updated " << updatedCount << " rows in '" << tableName << "'." << endl;
@@ -6,6 +6,9 @@
 
 extern float BLOCK_SIZE;
 extern uint BLOCK_COUNT;
+extern uint PREFETCH_DEPTH;
+extern uint THREAD_COUNT;
+extern bool PERSIST;
 extern uint PRINT_COUNT;
 extern vector<string> tokenizedQuery;
 extern ParsedQuery parsedQuery;
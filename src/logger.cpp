@@ -7,5 +7,7 @@ Logger::Logger()
 
 void Logger::log(string logString)
 {
+    // The read-ahead worker logs too
+    lock_guard<mutex> lock(this->logMutex);
     fout << logString << endl;
 }
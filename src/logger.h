@@ -1,7 +1,12 @@
 #include<iostream>
 #include<bits/stdc++.h>
 #include<sys/stat.h> 
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/uio.h>
+#include<sys/mman.h>
 #include<fstream>
+#include<mutex>
 
 using namespace std;
 
@@ -9,6 +14,7 @@ class Logger{
 
     string logFile = "log";
     ofstream fout;
+    mutex logMutex;
     
     public:
 
@@ -10,52 +10,150 @@ Page::Page()
     this->pageIndex = -1;
     this->rowCount = 0;
     this->columnCount = 0;
-    this->rows.clear();
+    this->layout = ROW_MAJOR;
+    this->values.clear();
 }
 
 /**
  * @brief Construct a new Page:: Page object given the table name and page
  * index. When tables are loaded they are broken up into blocks of BLOCK_SIZE
- * and each block is stored in a different file named
- * "<tablename>_Page<pageindex>". For example, If the Page being loaded is of
- * table "R" and the pageIndex is 2 then the file name is "R_Page2". The page
- * loads the rows (or tuples) into a vector of rows (where each row is a vector
- * of integers).
+ * and all blocks of a table are stored in a single segment file named
+ * "<tablename>_Segment", block i starting at offset i * pageSize(). For
+ * example, If the Page being loaded is of table "R" and the pageIndex is 2
+ * then the page is read from "R_Segment" at offset 2 * pageSize(). The page is
+ * binary: a PageHeader followed by the packed values, so the whole block is
+ * read in with a single scattered read that places the header and the values
+ * straight into their final buffers.
  *
- * @param tableName 
- * @param pageIndex 
+ * @param tableName
+ * @param pageIndex
  */
-Page::Page(string tableName, int pageIndex)
+Page::Page(string tableName, int pageIndex) : Page(tableName, pageIndex, bufferManager.getSegment(tableName))
+{
+}
+
+/**
+ * @brief Same as above, reading from an already open segment descriptor.
+ * Does not touch the buffer manager, so the read-ahead worker can use it.
+ *
+ * @param tableName
+ * @param pageIndex
+ * @param fd
+ */
+Page::Page(string tableName, int pageIndex, int fd)
 {
     logger.log("Page::Page");
     this->tableName = tableName;
     this->pageIndex = pageIndex;
     this->pageName = "../data/temp/" + this->tableName + "_Page" + to_string(pageIndex);
-    Table table = *tableCatalogue.getTable(tableName);
-    this->columnCount = table.columnCount;
-    uint maxRowCount = table.maxRowsPerBlock;
-    vector<int> row(columnCount, 0);
-    this->rows.assign(maxRowCount, row);
-
-    ifstream fin(pageName, ios::in);
-    this->rowCount = table.rowsPerBlockCount[pageIndex];
-    int number;
-    for (uint rowCounter = 0; rowCounter < this->rowCount; rowCounter++)
+    this->columnCount = 0;
+    this->rowCount = 0;
+    this->layout = ROW_MAJOR;
+
+    PageHeader header;
+    this->values.resize((pageSize() - sizeof(PageHeader)) / sizeof(int32_t));
+    struct iovec block[2] = {{&header, sizeof(PageHeader)},
+                             {this->values.data(), this->values.size() * sizeof(int32_t)}};
+    ssize_t bytesRead = preadv(fd, block, 2, (off_t)pageIndex * pageSize());
+    if (!this->acceptHeader(header, max(bytesRead, (ssize_t)0)))
     {
-        for (int columnCounter = 0; columnCounter < columnCount; columnCounter++)
-        {
-            fin >> number;
-            this->rows[rowCounter][columnCounter] = number;
-        }
+        this->values.clear();
+        return;
+    }
+    this->values.resize((size_t)this->rowCount * this->columnCount);
+    if (computeChecksum(this->values.data(), this->values.size()) != header.checksum)
+    {
+        logger.log("Page::Page: Err - checksum mismatch in " + this->pageName);
+        throw PageCorruptedError("block " + to_string(pageIndex) + " of table " + tableName + " is corrupted (checksum mismatch)");
+    }
+}
+
+/**
+ * @brief Same as above, but the page is read in place from a mapping of the
+ * segment instead of being copied out of it. The mapping has to cover at
+ * least the start of the block.
+ *
+ * @param tableName
+ * @param pageIndex
+ * @param mapping
+ */
+Page::Page(string tableName, int pageIndex, shared_ptr<const SegmentMapping> mapping)
+{
+    logger.log("Page::Page");
+    this->tableName = tableName;
+    this->pageIndex = pageIndex;
+    this->pageName = "../data/temp/" + this->tableName + "_Page" + to_string(pageIndex);
+    this->columnCount = 0;
+    this->rowCount = 0;
+    this->layout = ROW_MAJOR;
+
+    size_t offset = (size_t)pageIndex * pageSize();
+    PageHeader header;
+    if (!mapping || mapping->length < offset + sizeof(PageHeader))
+    {
+        logger.log("Page::Page: Err - could not read page " + this->pageName);
+        return;
+    }
+    memcpy(&header, mapping->address + offset, sizeof(PageHeader));
+    if (!this->acceptHeader(header, mapping->length - offset))
+        return;
+    const int *blockValues = (const int *)(mapping->address + offset + sizeof(PageHeader));
+    if (computeChecksum(blockValues, (size_t)this->rowCount * this->columnCount) != header.checksum)
+    {
+        logger.log("Page::Page: Err - checksum mismatch in " + this->pageName);
+        throw PageCorruptedError("block " + to_string(pageIndex) + " of table " + tableName + " is corrupted (checksum mismatch)");
+    }
+    this->mapping = mapping;
+    this->mappedValues = blockValues;
+}
+
+/**
+ * @brief Checks the header of a page that was read from disk against the
+ * number of bytes that were available for the block, and takes the page's
+ * shape from it.
+ *
+ * @param header
+ * @param bytesAvailable
+ * @return true if the header is valid and the payload is complete
+ * @return false otherwise
+ */
+bool Page::acceptHeader(const PageHeader &header, size_t bytesAvailable)
+{
+    if (bytesAvailable < sizeof(PageHeader))
+    {
+        logger.log("Page::Page: Err - could not read page " + this->pageName);
+        return false;
+    }
+    size_t valueCount = (size_t)header.rowCount * header.columnCount;
+    if (header.magic != PAGE_MAGIC || sizeof(PageHeader) + valueCount * sizeof(int32_t) > bytesAvailable)
+    {
+        logger.log("Page::Page: Err - bad page header in " + this->pageName);
+        return false;
     }
-    fin.close();
+    this->columnCount = header.columnCount;
+    this->rowCount = header.rowCount;
+    this->layout = (PageLayout)header.layout;
+    return true;
+}
+
+/**
+ * @brief Gives a page read through a mapping its own copy of the values, so
+ * it can be changed without touching the mapped segment.
+ */
+void Page::ownValues()
+{
+    if (!this->mappedValues)
+        return;
+    this->values.assign(this->mappedValues, this->mappedValues + (size_t)this->rowCount * this->columnCount);
+    this->mappedValues = nullptr;
+    this->mapping.reset();
 }
 
 /**
  * @brief Get row from page indexed by rowIndex
- * 
- * @param rowIndex 
- * @return vector<int> 
+ *
+ * @param rowIndex
+ * @return vector<int>
  */
 vector<int> Page::getRow(int rowIndex)
 {
@@ -64,55 +162,286 @@ vector<int> Page::getRow(int rowIndex)
     result.clear();
     if (rowIndex >= this->rowCount)
         return result;
-    return this->rows[rowIndex];
+    result.resize(this->columnCount);
+    for (int columnCounter = 0; columnCounter < this->columnCount; columnCounter++)
+        result[columnCounter] = this->getValue(rowIndex, columnCounter);
+    return result;
+}
+
+/**
+ * @brief Get only the given columns of the row indexed by rowIndex, in the
+ * order they are listed. On a PAX page the other minipages are not touched.
+ *
+ * @param rowIndex
+ * @param columnIndices
+ * @return vector<int>
+ */
+vector<int> Page::getRow(int rowIndex, const vector<int>& columnIndices)
+{
+    vector<int> result;
+    if (rowIndex >= this->rowCount)
+        return result;
+    result.resize(columnIndices.size());
+    this->copyRow(rowIndex, columnIndices, result.data());
+    return result;
+}
+
+/**
+ * @brief Copies the given columns of the row indexed by rowIndex to
+ * destination, which must have room for one value per listed column. An empty
+ * list of columns copies the whole row.
+ *
+ * @param rowIndex
+ * @param columnIndices
+ * @param destination
+ */
+void Page::copyRow(int rowIndex, const vector<int>& columnIndices, int *destination) const
+{
+    if (columnIndices.empty())
+    {
+        for (int columnCounter = 0; columnCounter < this->columnCount; columnCounter++)
+            destination[columnCounter] = this->getValue(rowIndex, columnCounter);
+        return;
+    }
+    for (int columnCounter = 0; columnCounter < columnIndices.size(); columnCounter++)
+        destination[columnCounter] = this->getValue(rowIndex, columnIndices[columnCounter]);
+}
+
+/**
+ * @brief Non-owning view of the row indexed by rowIndex. Only row-major pages
+ * store rows contiguously; on a PAX page, or past the last row, the view is
+ * empty.
+ *
+ * @param rowIndex
+ * @return span<const int>
+ */
+span<const int> Page::getRowView(int rowIndex) const
+{
+    if (this->layout != ROW_MAJOR || rowIndex >= this->rowCount)
+        return span<const int>();
+    return span<const int>(this->getValues() + (size_t)rowIndex * this->columnCount, this->columnCount);
 }
 
-Page::Page(string tableName, int pageIndex, vector<vector<int>> rows, int rowCount)
+/**
+ * @brief Non-owning view of the minipage of the column indexed by
+ * columnIndex. Only PAX pages store columns contiguously; on a row-major page
+ * the view is empty.
+ *
+ * @param columnIndex
+ * @return span<const int>
+ */
+span<const int> Page::getColumnView(int columnIndex) const
+{
+    if (this->layout != PAX || columnIndex >= this->columnCount)
+        return span<const int>();
+    return span<const int>(this->getValues() + (size_t)columnIndex * this->getColumnStride(), this->rowCount);
+}
+
+Page::Page(string tableName, int pageIndex, vector<vector<int>> rows, int rowCount, PageLayout layout)
 {
     logger.log("Page::Page");
     this->tableName = tableName;
     this->pageIndex = pageIndex;
-    this->rows = rows;
     this->rowCount = rowCount;
     this->columnCount = rows[0].size();
+    this->layout = layout;
     this->pageName = "../data/temp/"+this->tableName + "_Page" + to_string(pageIndex);
+    this->values.resize((size_t)rowCount * this->columnCount);
+    for (int rowCounter = 0; rowCounter < rowCount; rowCounter++)
+        for (int columnCounter = 0; columnCounter < this->columnCount; columnCounter++)
+            this->values[this->getOffset(rowCounter, columnCounter)] = rows[rowCounter][columnCounter];
+}
+
+/**
+ * @brief Construct a new Page from rows packed one after the other in a flat
+ * buffer of columnCount values per row.
+ *
+ * @param tableName
+ * @param pageIndex
+ * @param rows
+ * @param columnCount
+ * @param layout
+ */
+Page::Page(string tableName, int pageIndex, span<const int> rows, int columnCount, PageLayout layout)
+{
+    logger.log("Page::Page");
+    this->tableName = tableName;
+    this->pageIndex = pageIndex;
+    this->columnCount = columnCount;
+    this->rowCount = rows.size() / columnCount;
+    this->layout = layout;
+    this->pageName = "../data/temp/" + this->tableName + "_Page" + to_string(pageIndex);
+    if (layout == ROW_MAJOR)
+    {
+        this->values.assign(rows.begin(), rows.begin() + (size_t)this->rowCount * columnCount);
+        return;
+    }
+    this->values.resize((size_t)this->rowCount * columnCount);
+    for (int rowCounter = 0; rowCounter < this->rowCount; rowCounter++)
+        for (int columnCounter = 0; columnCounter < columnCount; columnCounter++)
+            this->values[this->getOffset(rowCounter, columnCounter)] = rows[(size_t)rowCounter * columnCount + columnCounter];
 }
 
 /**
- * @brief writes current page contents to file.
- * 
+ * @brief writes current page contents to its slot in the table's segment
+ * file. The value buffer already has the on-disk order for the page layout,
+ * so it is written out behind the PageHeader with one gathered write. A
+ * successful write leaves the page clean.
+ *
  */
 void Page::writePage()
 {
     logger.log("Page::writePage");
-    ofstream fout(this->pageName, ios::trunc);
-    for (int rowCounter = 0; rowCounter < this->rowCount; rowCounter++)
+    if (this->columnCapacity)
+        this->layOutColumns(0);
+    PageHeader header;
+    header.magic = PAGE_MAGIC;
+    header.columnCount = this->columnCount;
+    header.rowCount = this->rowCount;
+    size_t valueCount = (size_t)this->rowCount * this->columnCount;
+    header.checksum = computeChecksum(this->getValues(), valueCount);
+    header.layout = this->layout;
+
+    size_t blockSize = sizeof(PageHeader) + valueCount * sizeof(int32_t);
+    if (blockSize > pageSize())
     {
-        for (int columnCounter = 0; columnCounter < this->columnCount; columnCounter++)
-        {
-            if (columnCounter != 0)
-                fout << " ";
-            fout << this->rows[rowCounter][columnCounter];
-        }
-        fout << endl;
+        logger.log("Page::writePage: Err - page does not fit in a block");
+        return;
+    }
+    struct iovec block[2] = {{&header, sizeof(PageHeader)},
+                             {(void *)this->getValues(), valueCount * sizeof(int32_t)}};
+
+    int fd = bufferManager.getSegment(this->tableName);
+    if (pwritev(fd, block, 2, (off_t)this->pageIndex * pageSize()) != (ssize_t)blockSize)
+        logger.log("Page::writePage: Err - short write to " + this->pageName);
+    else
+        this->dirty = false;
+}
+
+/**
+ * @brief Size of one block slot in a segment file: the page header plus
+ * BLOCK_SIZE kilobytes of row data. Tables derive maxRowsPerBlock from
+ * BLOCK_SIZE, so a full page always fits in its slot.
+ *
+ * @return size_t
+ */
+size_t Page::pageSize()
+{
+    return sizeof(PageHeader) + (size_t)(BLOCK_SIZE * 1000);
+}
+
+/**
+ * @brief FNV-1a style checksum over the packed int32 payload of a page. It is
+ * only meant to catch torn or stale page files, not to be cryptographically
+ * strong.
+ *
+ * @param values
+ * @param valueCount
+ * @return uint32_t
+ */
+uint32_t Page::computeChecksum(const int32_t *values, size_t valueCount)
+{
+    uint32_t checksum = 2166136261u;
+    for (size_t valueCounter = 0; valueCounter < valueCount; valueCounter++)
+    {
+        checksum ^= (uint32_t)values[valueCounter];
+        checksum *= 16777619u;
     }
-    fout.close();
+    return checksum;
 }
-void Page::updateRow(int rowIndex, const vector<int>& row)
+
+/**
+ * @brief Overwrites a row of the page in place and marks the page dirty. When
+ * the page is a buffer pool frame the change is visible to every handle at
+ * once and reaches the segment file when the frame is written back.
+ *
+ * @param rowIndex
+ * @param row
+ */
+void Page::updateRow(int rowIndex, span<const int> row)
 {
     logger.log("Page::updateRow");
     if (rowIndex >= this->rowCount) {
         logger.log("Page::updateRow: Error - Row index out of bounds");
         return;
     }
-    
+
     // Update the row with new values
+    this->ownValues();
     for (int columnCounter = 0; columnCounter < this->columnCount; columnCounter++) {
-        this->rows[rowIndex][columnCounter] = row[columnCounter];
+        this->values[this->getOffset(rowIndex, columnCounter)] = row[columnCounter];
+    }
+    this->dirty = true;
+}
+
+/**
+ * @brief Overwrites a single value in place and marks the page dirty.
+ *
+ * @param rowIndex
+ * @param columnIndex
+ * @param value
+ */
+void Page::setValue(int rowIndex, int columnIndex, int value)
+{
+    this->ownValues();
+    this->values[this->getOffset(rowIndex, columnIndex)] = value;
+    this->dirty = true;
+}
+
+/**
+ * @brief Moves the minipages of a PAX page apart so that each has room for
+ * capacity rows, or packs them back to back again if capacity is 0.
+ *
+ * @param capacity
+ */
+void Page::layOutColumns(int capacity)
+{
+    int stride = capacity ? capacity : this->rowCount;
+    vector<int> minipages((size_t)stride * this->columnCount);
+    for (int columnCounter = 0; columnCounter < this->columnCount; columnCounter++)
+    {
+        span<const int> minipage = this->getColumnView(columnCounter);
+        copy(minipage.begin(), minipage.end(), minipages.begin() + (size_t)columnCounter * stride);
     }
+    this->values.swap(minipages);
+    this->columnCapacity = capacity;
 }
+
+/**
+ * @brief Adds a row after the last row of the page and marks the page dirty.
+ * The caller makes sure the page still has room for the row. On a PAX page
+ * the first append reserves room for as many rows as fit in a block at the
+ * end of every minipage, so later appends only write one value per column.
+ *
+ * @param row
+ */
+void Page::appendRow(span<const int> row)
+{
+    logger.log("Page::appendRow");
+    this->ownValues();
+    if (this->columnCount == 0)
+        this->columnCount = row.size();
+    if (this->layout == ROW_MAJOR)
+        this->values.insert(this->values.end(), row.begin(), row.begin() + this->columnCount);
+    else
+    {
+        if (this->rowCount >= this->columnCapacity)
+        {
+            int blockRows = (pageSize() - sizeof(PageHeader)) / sizeof(int32_t) / this->columnCount;
+            this->layOutColumns(max(blockRows, this->rowCount + 1));
+        }
+        for (int columnCounter = 0; columnCounter < this->columnCount; columnCounter++)
+            this->values[(size_t)columnCounter * this->columnCapacity + this->rowCount] = row[columnCounter];
+    }
+    this->rowCount++;
+    this->dirty = true;
+}
+
 vector<vector<int>> Page::getRows() {
-    return this->rows;
+    vector<vector<int>> rows(this->rowCount);
+    for (int rowCounter = 0; rowCounter < this->rowCount; rowCounter++)
+        rows[rowCounter] = this->getRow(rowCounter);
+    return rows;
 }
 
 int Page::getRowCount()
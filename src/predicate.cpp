@@ -0,0 +1,351 @@
+#include "global.h"
+#include <immintrin.h>
+
+typedef void (*PredicateKernel)(const int *left, const int *right, int literal, int rowCount, uint64_t *bitmap);
+
+/**
+ * @brief Scalar comparison. The operator is a template argument so the
+ * switch is resolved at compile time and the kernel loops carry no branch on
+ * the operator.
+ */
+template <BinaryOperator binaryOperator>
+static inline bool compareValues(int value1, int value2)
+{
+    switch (binaryOperator)
+    {
+    case LESS_THAN:
+        return value1 < value2;
+    case GREATER_THAN:
+        return value1 > value2;
+    case LEQ:
+        return value1 <= value2;
+    case GEQ:
+        return value1 >= value2;
+    case EQUAL:
+        return value1 == value2;
+    default:
+        return value1 != value2;
+    }
+}
+
+template <BinaryOperator binaryOperator, bool againstColumn>
+static void scalarKernel(const int *left, const int *right, int literal, int rowCount, uint64_t *bitmap)
+{
+    for (int rowCounter = 0; rowCounter < rowCount; rowCounter++)
+        if (compareValues<binaryOperator>(left[rowCounter], againstColumn ? right[rowCounter] : literal))
+            bitmap[rowCounter >> 6] |= 1ULL << (rowCounter & 63);
+}
+
+/**
+ * @brief Only "equal" and "greater than" exist as SIMD integer compares. The
+ * other operators swap the operands and/or negate the resulting lane mask:
+ * a < b is b > a, a <= b is !(a > b), a >= b is !(b > a), a != b is !(a == b).
+ */
+template <BinaryOperator binaryOperator>
+__attribute__((target("avx2"))) static inline int compareLanes(__m256i value1, __m256i value2)
+{
+    __m256i lanes;
+    if constexpr (binaryOperator == EQUAL || binaryOperator == NOT_EQUAL)
+        lanes = _mm256_cmpeq_epi32(value1, value2);
+    else if constexpr (binaryOperator == GREATER_THAN || binaryOperator == LEQ)
+        lanes = _mm256_cmpgt_epi32(value1, value2);
+    else
+        lanes = _mm256_cmpgt_epi32(value2, value1);
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(lanes));
+    if constexpr (binaryOperator == NOT_EQUAL || binaryOperator == LEQ || binaryOperator == GEQ)
+        mask ^= 0xFF;
+    return mask;
+}
+
+template <BinaryOperator binaryOperator, bool againstColumn>
+__attribute__((target("avx2"))) static void avx2Kernel(const int *left, const int *right, int literal, int rowCount, uint64_t *bitmap)
+{
+    __m256i literals = _mm256_set1_epi32(literal);
+    int rowCounter = 0;
+    for (; rowCounter + 8 <= rowCount; rowCounter += 8)
+    {
+        __m256i value1 = _mm256_loadu_si256((const __m256i *)(left + rowCounter));
+        __m256i value2 = againstColumn ? _mm256_loadu_si256((const __m256i *)(right + rowCounter)) : literals;
+        bitmap[rowCounter >> 6] |= (uint64_t)compareLanes<binaryOperator>(value1, value2) << (rowCounter & 63);
+    }
+    for (; rowCounter < rowCount; rowCounter++)
+        if (compareValues<binaryOperator>(left[rowCounter], againstColumn ? right[rowCounter] : literal))
+            bitmap[rowCounter >> 6] |= 1ULL << (rowCounter & 63);
+}
+
+template <BinaryOperator binaryOperator>
+__attribute__((target("sse4.2"))) static inline int compareLanes(__m128i value1, __m128i value2)
+{
+    __m128i lanes;
+    if constexpr (binaryOperator == EQUAL || binaryOperator == NOT_EQUAL)
+        lanes = _mm_cmpeq_epi32(value1, value2);
+    else if constexpr (binaryOperator == GREATER_THAN || binaryOperator == LEQ)
+        lanes = _mm_cmpgt_epi32(value1, value2);
+    else
+        lanes = _mm_cmpgt_epi32(value2, value1);
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(lanes));
+    if constexpr (binaryOperator == NOT_EQUAL || binaryOperator == LEQ || binaryOperator == GEQ)
+        mask ^= 0xF;
+    return mask;
+}
+
+template <BinaryOperator binaryOperator, bool againstColumn>
+__attribute__((target("sse4.2"))) static void sse4Kernel(const int *left, const int *right, int literal, int rowCount, uint64_t *bitmap)
+{
+    __m128i literals = _mm_set1_epi32(literal);
+    int rowCounter = 0;
+    for (; rowCounter + 4 <= rowCount; rowCounter += 4)
+    {
+        __m128i value1 = _mm_loadu_si128((const __m128i *)(left + rowCounter));
+        __m128i value2 = againstColumn ? _mm_loadu_si128((const __m128i *)(right + rowCounter)) : literals;
+        bitmap[rowCounter >> 6] |= (uint64_t)compareLanes<binaryOperator>(value1, value2) << (rowCounter & 63);
+    }
+    for (; rowCounter < rowCount; rowCounter++)
+        if (compareValues<binaryOperator>(left[rowCounter], againstColumn ? right[rowCounter] : literal))
+            bitmap[rowCounter >> 6] |= 1ULL << (rowCounter & 63);
+}
+
+/**
+ * @brief Kernel tables indexed by [operator][against column], in the order of
+ * the BinaryOperator enum.
+ */
+static const PredicateKernel scalarKernels[6][2] = {
+    {scalarKernel<LESS_THAN, false>, scalarKernel<LESS_THAN, true>},
+    {scalarKernel<GREATER_THAN, false>, scalarKernel<GREATER_THAN, true>},
+    {scalarKernel<LEQ, false>, scalarKernel<LEQ, true>},
+    {scalarKernel<GEQ, false>, scalarKernel<GEQ, true>},
+    {scalarKernel<EQUAL, false>, scalarKernel<EQUAL, true>},
+    {scalarKernel<NOT_EQUAL, false>, scalarKernel<NOT_EQUAL, true>}};
+
+static const PredicateKernel sse4Kernels[6][2] = {
+    {sse4Kernel<LESS_THAN, false>, sse4Kernel<LESS_THAN, true>},
+    {sse4Kernel<GREATER_THAN, false>, sse4Kernel<GREATER_THAN, true>},
+    {sse4Kernel<LEQ, false>, sse4Kernel<LEQ, true>},
+    {sse4Kernel<GEQ, false>, sse4Kernel<GEQ, true>},
+    {sse4Kernel<EQUAL, false>, sse4Kernel<EQUAL, true>},
+    {sse4Kernel<NOT_EQUAL, false>, sse4Kernel<NOT_EQUAL, true>}};
+
+static const PredicateKernel avx2Kernels[6][2] = {
+    {avx2Kernel<LESS_THAN, false>, avx2Kernel<LESS_THAN, true>},
+    {avx2Kernel<GREATER_THAN, false>, avx2Kernel<GREATER_THAN, true>},
+    {avx2Kernel<LEQ, false>, avx2Kernel<LEQ, true>},
+    {avx2Kernel<GEQ, false>, avx2Kernel<GEQ, true>},
+    {avx2Kernel<EQUAL, false>, avx2Kernel<EQUAL, true>},
+    {avx2Kernel<NOT_EQUAL, false>, avx2Kernel<NOT_EQUAL, true>}};
+
+static const PredicateKernel (*activeKernels)[2] = nullptr;
+static string activeKernelName = "";
+
+/**
+ * @brief Picks the widest kernel family the CPU supports.
+ */
+static void detectPredicateKernel()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        setPredicateKernel("AVX2");
+    else if (__builtin_cpu_supports("sse4.2"))
+        setPredicateKernel("SSE4");
+    else
+        setPredicateKernel("SCALAR");
+    logger.log("detectPredicateKernel: " + activeKernelName);
+}
+
+/**
+ * @brief Forces a kernel family (AVX2, SSE4 or SCALAR). Families the CPU does
+ * not support are refused.
+ *
+ * @param kernelName
+ * @return true if the family is now in use
+ * @return false otherwise
+ */
+bool setPredicateKernel(string kernelName)
+{
+    __builtin_cpu_init();
+    if (kernelName == "AVX2" && __builtin_cpu_supports("avx2"))
+        activeKernels = avx2Kernels;
+    else if (kernelName == "SSE4" && __builtin_cpu_supports("sse4.2"))
+        activeKernels = sse4Kernels;
+    else if (kernelName == "SCALAR")
+        activeKernels = scalarKernels;
+    else
+        return false;
+    activeKernelName = kernelName;
+    return true;
+}
+
+string getPredicateKernelName()
+{
+    if (!activeKernels)
+        detectPredicateKernel();
+    return activeKernelName;
+}
+
+int getBitmapWordCount(int rowCount)
+{
+    return (rowCount + 63) / 64;
+}
+
+/**
+ * @brief Sets the bits of the rows of column for which "value OP literal"
+ * holds. bitmap needs getBitmapWordCount(column.size()) words and is cleared
+ * first.
+ *
+ * @param column
+ * @param binaryOperator
+ * @param literal
+ * @param bitmap
+ */
+void evaluatePredicate(span<const int> column, BinaryOperator binaryOperator, int literal, uint64_t *bitmap)
+{
+    fill(bitmap, bitmap + getBitmapWordCount(column.size()), 0);
+    if (binaryOperator == NO_BINOP_CLAUSE)
+        return;
+    if (!activeKernels)
+        detectPredicateKernel();
+    activeKernels[binaryOperator][0](column.data(), nullptr, literal, column.size(), bitmap);
+}
+
+/**
+ * @brief Sets the bits of the rows for which "left OP right" holds. Both
+ * columns must have the same length.
+ *
+ * @param leftColumn
+ * @param rightColumn
+ * @param binaryOperator
+ * @param bitmap
+ */
+void evaluatePredicate(span<const int> leftColumn, span<const int> rightColumn, BinaryOperator binaryOperator, uint64_t *bitmap)
+{
+    fill(bitmap, bitmap + getBitmapWordCount(leftColumn.size()), 0);
+    if (binaryOperator == NO_BINOP_CLAUSE)
+        return;
+    if (!activeKernels)
+        detectPredicateKernel();
+    activeKernels[binaryOperator][1](leftColumn.data(), rightColumn.data(), 0, leftColumn.size(), bitmap);
+}
+
+/**
+ * @brief Maps the operator tokens used by the queries to BinaryOperator, or
+ * NO_BINOP_CLAUSE if the token is not an operator.
+ *
+ * @param binaryOperator
+ * @return BinaryOperator
+ */
+BinaryOperator parseBinaryOperator(string binaryOperator)
+{
+    if (binaryOperator == "<")
+        return LESS_THAN;
+    if (binaryOperator == ">")
+        return GREATER_THAN;
+    if (binaryOperator == "<=" || binaryOperator == "=<")
+        return LEQ;
+    if (binaryOperator == ">=" || binaryOperator == "=>")
+        return GEQ;
+    if (binaryOperator == "==")
+        return EQUAL;
+    if (binaryOperator == "!=")
+        return NOT_EQUAL;
+    return NO_BINOP_CLAUSE;
+}
+
+BinaryOperator negateBinaryOperator(BinaryOperator binaryOperator)
+{
+    switch (binaryOperator)
+    {
+    case LESS_THAN:
+        return GEQ;
+    case GREATER_THAN:
+        return LEQ;
+    case LEQ:
+        return GREATER_THAN;
+    case GEQ:
+        return LESS_THAN;
+    case EQUAL:
+        return NOT_EQUAL;
+    case NOT_EQUAL:
+        return EQUAL;
+    default:
+        return NO_BINOP_CLAUSE;
+    }
+}
+
+/**
+ * @brief The operator that gives the same result with its operands swapped,
+ * i.e. "a OP b" is "b flipBinaryOperator(OP) a".
+ *
+ * @param binaryOperator
+ * @return BinaryOperator
+ */
+BinaryOperator flipBinaryOperator(BinaryOperator binaryOperator)
+{
+    switch (binaryOperator)
+    {
+    case LESS_THAN:
+        return GREATER_THAN;
+    case GREATER_THAN:
+        return LESS_THAN;
+    case LEQ:
+        return GEQ;
+    case GEQ:
+        return LEQ;
+    default:
+        return binaryOperator;
+    }
+}
+
+/**
+ * @brief Whether some value of the column within the zone's range could
+ * satisfy "value OP literal". A zone that was never filled tells nothing,
+ * so the block has to be read.
+ *
+ * @param zone
+ * @param columnIndex
+ * @param binaryOperator
+ * @param literal
+ * @return true if the block has to be read
+ * @return false if no row of the block can qualify
+ */
+bool zoneMayMatch(const ZoneMap &zone, int columnIndex, BinaryOperator binaryOperator, int literal)
+{
+    if (zone.minValues.empty())
+        return true;
+    int minValue = zone.minValues[columnIndex];
+    int maxValue = zone.maxValues[columnIndex];
+    switch (binaryOperator)
+    {
+    case LESS_THAN:
+        return minValue < literal;
+    case GREATER_THAN:
+        return maxValue > literal;
+    case LEQ:
+        return minValue <= literal;
+    case GEQ:
+        return maxValue >= literal;
+    case EQUAL:
+        return minValue <= literal && literal <= maxValue;
+    case NOT_EQUAL:
+        return minValue != literal || maxValue != literal;
+    default:
+        return true;
+    }
+}
+
+/**
+ * @brief Block filter for a scan with the condition "column OP literal":
+ * tells for a block index whether the block may hold a qualifying row.
+ *
+ * @param table
+ * @param columnIndex
+ * @param binaryOperator
+ * @param literal
+ * @return function<bool(int)>
+ */
+function<bool(int)> getZoneFilter(Table *table, int columnIndex, BinaryOperator binaryOperator, int literal)
+{
+    return [table, columnIndex, binaryOperator, literal](int blockIndex) {
+        if (blockIndex >= (int)table->zoneMaps.size())
+            return true;
+        return zoneMayMatch(table->zoneMaps[blockIndex], columnIndex, binaryOperator, literal);
+    };
+}
\ No newline at end of file
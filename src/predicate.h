@@ -0,0 +1,46 @@
+#include"semanticParser.h"
+
+/**
+ * @brief Predicate kernels evaluate "column OP literal" or "column OP column"
+ * over a run of int32 values and produce a selection bitmap with one bit per
+ * value: bit r of word r / 64 is set if row r qualifies. Scans in SELECT,
+ * SEARCH, DELETE and UPDATE parse their operator once and hand whole batches
+ * or pages to the kernels instead of testing the operator per row.
+ *
+ * <p>
+ * There are AVX2 (8 values per instruction), SSE4.2 (4 values) and scalar
+ * versions of every kernel. The widest one the CPU supports is chosen through
+ * CPUID the first time a kernel runs; --predicate-kernel overrides the choice.
+ * </p>
+ */
+
+BinaryOperator parseBinaryOperator(string binaryOperator);
+BinaryOperator negateBinaryOperator(BinaryOperator binaryOperator);
+BinaryOperator flipBinaryOperator(BinaryOperator binaryOperator);
+
+int getBitmapWordCount(int rowCount);
+void evaluatePredicate(span<const int> column, BinaryOperator binaryOperator, int literal, uint64_t *bitmap);
+void evaluatePredicate(span<const int> leftColumn, span<const int> rightColumn, BinaryOperator binaryOperator, uint64_t *bitmap);
+
+bool zoneMayMatch(const ZoneMap &zone, int columnIndex, BinaryOperator binaryOperator, int literal);
+function<bool(int)> getZoneFilter(Table *table, int columnIndex, BinaryOperator binaryOperator, int literal);
+
+bool setPredicateKernel(string kernelName);
+string getPredicateKernelName();
+
+/**
+ * @brief Calls function with the index of every row whose bit is set in the
+ * selection bitmap, in increasing order.
+ *
+ * @param bitmap
+ * @param rowCount
+ * @param function
+ */
+template <typename Function>
+void forEachSelectedRow(const uint64_t *bitmap, int rowCount, Function function)
+{
+    int wordCount = getBitmapWordCount(rowCount);
+    for (int wordCounter = 0; wordCounter < wordCount; wordCounter++)
+        for (uint64_t bits = bitmap[wordCounter]; bits; bits &= bits - 1)
+            function(wordCounter * 64 + __builtin_ctzll(bits));
+}
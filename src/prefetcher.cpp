@@ -0,0 +1,162 @@
+#include "global.h"
+
+/**
+ * @brief Stops the worker. Requests still queued are dropped; a read in
+ * flight is allowed to finish.
+ */
+Prefetcher::~Prefetcher()
+{
+    {
+        lock_guard<mutex> lock(this->prefetchMutex);
+        this->stopping = true;
+        this->requests.clear();
+    }
+    this->requestQueued.notify_all();
+    if (this->worker.joinable())
+        this->worker.join();
+}
+
+/**
+ * @brief Worker loop: takes requests in the order they were queued, reads
+ * the page from its segment and stages it. A page that turns out to be
+ * corrupted is not staged, so the scan reads it itself and reports it.
+ */
+void Prefetcher::run()
+{
+    unique_lock<mutex> lock(this->prefetchMutex);
+    while (true)
+    {
+        this->requestQueued.wait(lock, [&] { return this->stopping || !this->requests.empty(); });
+        if (this->stopping)
+            return;
+        PrefetchRequest request = this->requests.front();
+        this->requests.pop_front();
+        this->inFlight = true;
+        this->inFlightKey = request.pageKey;
+        lock.unlock();
+        shared_ptr<Page> page;
+        try
+        {
+            page = make_shared<Page>(request.tableName, request.pageIndex, request.fd);
+        }
+        catch (const PageCorruptedError &)
+        {
+        }
+        lock.lock();
+        if (page)
+        {
+            if (this->stagedPages.size() >= BLOCK_COUNT)
+                this->stagedPages.erase(this->stagedPages.begin());
+            this->stagedPages[request.pageKey] = page;
+        }
+        this->inFlight = false;
+        this->pageRead.notify_all();
+    }
+}
+
+/**
+ * @brief Blocks until the page being read by the worker, if any, is not one
+ * of the pages matches selects.
+ *
+ * @param lock
+ * @param matches
+ */
+void Prefetcher::waitForInFlight(unique_lock<mutex> &lock, function<bool(uint64_t)> matches)
+{
+    this->pageRead.wait(lock, [&] { return !this->inFlight || !matches(this->inFlightKey); });
+}
+
+/**
+ * @brief Whether the page is queued, being read or staged.
+ *
+ * @param pageKey
+ */
+bool Prefetcher::isStaged(uint64_t pageKey)
+{
+    lock_guard<mutex> lock(this->prefetchMutex);
+    if (this->stagedPages.count(pageKey) || (this->inFlight && this->inFlightKey == pageKey))
+        return true;
+    for (PrefetchRequest &request : this->requests)
+        if (request.pageKey == pageKey)
+            return true;
+    return false;
+}
+
+/**
+ * @brief Queues a page to be read by the worker, starting the worker the
+ * first time it is needed. The caller makes sure the page is neither in the
+ * pool nor already staged.
+ *
+ * @param request
+ */
+void Prefetcher::request(PrefetchRequest request)
+{
+    logger.log("Prefetcher::request");
+    {
+        lock_guard<mutex> lock(this->prefetchMutex);
+        if (this->requests.size() >= BLOCK_COUNT)
+            return;
+        this->requests.push_back(request);
+        if (!this->worker.joinable())
+            this->worker = thread(&Prefetcher::run, this);
+    }
+    this->requestQueued.notify_one();
+}
+
+/**
+ * @brief Hands over the staged copy of a page, waiting for the worker if the
+ * page is being read right now. A request that has not been started yet is
+ * withdrawn.
+ *
+ * @param pageKey
+ * @return shared_ptr<Page> the page, or nullptr if it has to be read by the
+ * caller
+ */
+shared_ptr<Page> Prefetcher::claim(uint64_t pageKey)
+{
+    unique_lock<mutex> lock(this->prefetchMutex);
+    erase_if(this->requests, [&](PrefetchRequest &request) { return request.pageKey == pageKey; });
+    this->waitForInFlight(lock, [&](uint64_t inFlightKey) { return inFlightKey == pageKey; });
+    auto staged = this->stagedPages.find(pageKey);
+    if (staged == this->stagedPages.end())
+        return nullptr;
+    shared_ptr<Page> page = staged->second;
+    this->stagedPages.erase(staged);
+    return page;
+}
+
+/**
+ * @brief Forgets any copy of the page, queued, in flight or staged.
+ *
+ * @param pageKey
+ */
+void Prefetcher::discard(uint64_t pageKey)
+{
+    this->claim(pageKey);
+}
+
+/**
+ * @brief Forgets every page of a table. Returns only once the worker is no
+ * longer reading from the table's segment, so the segment can be closed.
+ *
+ * @param tableId
+ */
+void Prefetcher::discardTable(uint tableId)
+{
+    unique_lock<mutex> lock(this->prefetchMutex);
+    auto ofTable = [&](uint64_t pageKey) { return (pageKey >> 32) == tableId; };
+    erase_if(this->requests, [&](PrefetchRequest &request) { return ofTable(request.pageKey); });
+    this->waitForInFlight(lock, ofTable);
+    erase_if(this->stagedPages, [&](auto &staged) { return ofTable(staged.first); });
+}
+
+/**
+ * @brief Forgets every page.
+ */
+void Prefetcher::discardAll()
+{
+    unique_lock<mutex> lock(this->prefetchMutex);
+    this->requests.clear();
+    this->waitForInFlight(lock, [](uint64_t) { return true; });
+    this->stagedPages.clear();
+}
\ No newline at end of file
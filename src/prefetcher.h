@@ -0,0 +1,57 @@
+#include"replacementPolicy.h"
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+
+/**
+ * @brief The Prefetcher reads pages ahead of a sequential scan on a
+ * background worker thread, so the disk read of page k+1..k+N overlaps the
+ * work the executor does on page k. Only the buffer manager talks to it.
+ *
+ * <p>
+ * Pages read by the worker are staged outside the pool. When the scan gets
+ * there, the buffer manager claims the staged page (waiting for it if the read
+ * is still in flight) and inserts it into the pool like any other page, so the
+ * replacement policy and pinning stay on the executor thread. A request that
+ * is still queued when its page is needed is withdrawn and the page is read
+ * in the usual way instead of waiting behind the queue.
+ * </p>
+ * <p>
+ * A scan asks for at most PREFETCH_DEPTH pages ahead, and requests and staged
+ * pages are each limited to BLOCK_COUNT; when the staging area is full, a
+ * staged page nobody claimed is given up. Staged copies of a page are
+ * discarded whenever the page or its segment is rewritten or deleted.
+ * </p>
+ */
+struct PrefetchRequest{
+    uint64_t pageKey;
+    string tableName;
+    int pageIndex;
+    int fd;
+};
+
+class Prefetcher{
+
+    thread worker;
+    mutex prefetchMutex;
+    condition_variable requestQueued;
+    condition_variable pageRead;
+    deque<PrefetchRequest> requests;
+    unordered_map<uint64_t, shared_ptr<Page>> stagedPages;
+    bool inFlight = false;
+    uint64_t inFlightKey = 0;
+    bool stopping = false;
+
+    void run();
+    void waitForInFlight(unique_lock<mutex> &lock, function<bool(uint64_t)> matches);
+
+    public:
+
+    ~Prefetcher();
+    bool isStaged(uint64_t pageKey);
+    void request(PrefetchRequest request);
+    shared_ptr<Page> claim(uint64_t pageKey);
+    void discard(uint64_t pageKey);
+    void discardTable(uint tableId);
+    void discardAll();
+};
\ No newline at end of file
@@ -0,0 +1,318 @@
+#include "global.h"
+
+/**
+ * @brief Returns a new policy object for the given name, or nullptr if the
+ * name is not one of FIFO, LRU, CLOCK, LRU-K or 2Q.
+ *
+ * @param policyName
+ * @return ReplacementPolicy*
+ */
+ReplacementPolicy *createReplacementPolicy(string policyName)
+{
+    if (policyName == "FIFO")
+        return new FIFOPolicy();
+    if (policyName == "LRU")
+        return new LRUPolicy();
+    if (policyName == "CLOCK")
+        return new ClockPolicy();
+    if (policyName == "LRU-K" || policyName == "LRU2")
+        return new LRUKPolicy();
+    if (policyName == "2Q")
+        return new TwoQueuePolicy();
+    return nullptr;
+}
+
+void FIFOPolicy::recordInsert(uint64_t pageKey)
+{
+    this->positions[pageKey] = this->queue.insert(this->queue.end(), pageKey);
+}
+
+void FIFOPolicy::recordAccess(uint64_t)
+{
+}
+
+void FIFOPolicy::recordRemove(uint64_t pageKey)
+{
+    auto position = this->positions.find(pageKey);
+    if (position == this->positions.end())
+        return;
+    this->queue.erase(position->second);
+    this->positions.erase(position);
+}
+
+bool FIFOPolicy::pickVictim(function<bool(uint64_t)> isEvictable, uint64_t &victim)
+{
+    for (uint64_t pageKey : this->queue)
+    {
+        if (isEvictable(pageKey))
+        {
+            victim = pageKey;
+            this->recordRemove(pageKey);
+            return true;
+        }
+    }
+    return false;
+}
+
+void LRUPolicy::recordInsert(uint64_t pageKey)
+{
+    this->positions[pageKey] = this->recency.insert(this->recency.end(), pageKey);
+}
+
+void LRUPolicy::recordAccess(uint64_t pageKey)
+{
+    auto position = this->positions.find(pageKey);
+    if (position != this->positions.end())
+        this->recency.splice(this->recency.end(), this->recency, position->second);
+}
+
+void LRUPolicy::recordRemove(uint64_t pageKey)
+{
+    auto position = this->positions.find(pageKey);
+    if (position == this->positions.end())
+        return;
+    this->recency.erase(position->second);
+    this->positions.erase(position);
+}
+
+bool LRUPolicy::pickVictim(function<bool(uint64_t)> isEvictable, uint64_t &victim)
+{
+    for (uint64_t pageKey : this->recency)
+    {
+        if (isEvictable(pageKey))
+        {
+            victim = pageKey;
+            this->recordRemove(pageKey);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief New pages are placed just behind the hand so they are the last ones
+ * the hand reaches, and start with their reference bit clear.
+ *
+ * @param pageKey
+ */
+void ClockPolicy::recordInsert(uint64_t pageKey)
+{
+    ClockEntry entry;
+    entry.pageKey = pageKey;
+    entry.referenced = false;
+    this->positions[pageKey] = this->ring.insert(this->hand, entry);
+}
+
+void ClockPolicy::recordAccess(uint64_t pageKey)
+{
+    auto position = this->positions.find(pageKey);
+    if (position != this->positions.end())
+        position->second->referenced = true;
+}
+
+void ClockPolicy::recordRemove(uint64_t pageKey)
+{
+    auto position = this->positions.find(pageKey);
+    if (position == this->positions.end())
+        return;
+    if (this->hand == position->second)
+        this->hand++;
+    this->ring.erase(position->second);
+    this->positions.erase(position);
+}
+
+/**
+ * @brief Sweeps the hand at most twice around the ring: the first sweep may
+ * only clear reference bits, so a victim is always found in the second one
+ * unless every page is pinned.
+ *
+ * @param isEvictable
+ * @param victim
+ * @return true
+ * @return false
+ */
+bool ClockPolicy::pickVictim(function<bool(uint64_t)> isEvictable, uint64_t &victim)
+{
+    size_t steps = 2 * this->ring.size() + 1;
+    while (steps-- && !this->ring.empty())
+    {
+        if (this->hand == this->ring.end())
+            this->hand = this->ring.begin();
+        if (!isEvictable(this->hand->pageKey))
+        {
+            this->hand++;
+            continue;
+        }
+        if (this->hand->referenced)
+        {
+            this->hand->referenced = false;
+            this->hand++;
+            continue;
+        }
+        victim = this->hand->pageKey;
+        this->recordRemove(victim);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Pages with a full history of K references are ordered by their K-th
+ * most recent reference, the others (which have an infinite backward
+ * K-distance) by their last reference and always come first.
+ *
+ * @param pageKey
+ * @return Priority
+ */
+LRUKPolicy::Priority LRUKPolicy::getPriority(uint64_t pageKey)
+{
+    deque<uint64_t> &references = this->history[pageKey];
+    if (references.size() < K)
+        return Priority(0, references.back(), pageKey);
+    return Priority(1, references.front(), pageKey);
+}
+
+void LRUKPolicy::reference(uint64_t pageKey)
+{
+    deque<uint64_t> &references = this->history[pageKey];
+    references.push_back(++this->clock);
+    if (references.size() > K)
+        references.pop_front();
+}
+
+void LRUKPolicy::recordInsert(uint64_t pageKey)
+{
+    auto retainedPosition = this->retainedPositions.find(pageKey);
+    if (retainedPosition != this->retainedPositions.end())
+    {
+        this->retained.erase(retainedPosition->second);
+        this->retainedPositions.erase(retainedPosition);
+    }
+    else
+        this->history.erase(pageKey);
+    this->reference(pageKey);
+    Priority priority = this->getPriority(pageKey);
+    this->resident.insert(priority);
+    this->priorities[pageKey] = priority;
+}
+
+void LRUKPolicy::recordAccess(uint64_t pageKey)
+{
+    auto priority = this->priorities.find(pageKey);
+    if (priority == this->priorities.end())
+        return;
+    this->resident.erase(priority->second);
+    this->reference(pageKey);
+    priority->second = this->getPriority(pageKey);
+    this->resident.insert(priority->second);
+}
+
+void LRUKPolicy::recordRemove(uint64_t pageKey)
+{
+    auto priority = this->priorities.find(pageKey);
+    if (priority == this->priorities.end())
+        return;
+    this->resident.erase(priority->second);
+    this->priorities.erase(priority);
+    this->history.erase(pageKey);
+}
+
+bool LRUKPolicy::pickVictim(function<bool(uint64_t)> isEvictable, uint64_t &victim)
+{
+    for (const Priority &priority : this->resident)
+    {
+        uint64_t pageKey = get<2>(priority);
+        if (!isEvictable(pageKey))
+            continue;
+        victim = pageKey;
+        this->resident.erase(priority);
+        this->priorities.erase(pageKey);
+
+        this->retainedPositions[pageKey] = this->retained.insert(this->retained.end(), pageKey);
+        while (this->retained.size() > BLOCK_COUNT)
+        {
+            this->history.erase(this->retained.front());
+            this->retainedPositions.erase(this->retained.front());
+            this->retained.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Adds a page evicted from A1in to the ghost queue A1out, which holds
+ * up to half a pool's worth of page keys.
+ *
+ * @param pageKey
+ */
+void TwoQueuePolicy::remember(uint64_t pageKey)
+{
+    this->ghostPositions[pageKey] = this->a1out.insert(this->a1out.end(), pageKey);
+    while (this->a1out.size() > max(1u, BLOCK_COUNT / 2))
+    {
+        this->ghostPositions.erase(this->a1out.front());
+        this->a1out.pop_front();
+    }
+}
+
+void TwoQueuePolicy::recordInsert(uint64_t pageKey)
+{
+    auto ghost = this->ghostPositions.find(pageKey);
+    if (ghost != this->ghostPositions.end())
+    {
+        this->a1out.erase(ghost->second);
+        this->ghostPositions.erase(ghost);
+        this->positions[pageKey] = make_pair(AM, this->am.insert(this->am.end(), pageKey));
+    }
+    else
+        this->positions[pageKey] = make_pair(A1IN, this->a1in.insert(this->a1in.end(), pageKey));
+}
+
+/**
+ * @brief Only hits on Am change the order; a hit on a page that is still in
+ * A1in is treated as correlated with its first reference and ignored.
+ *
+ * @param pageKey
+ */
+void TwoQueuePolicy::recordAccess(uint64_t pageKey)
+{
+    auto position = this->positions.find(pageKey);
+    if (position != this->positions.end() && position->second.first == AM)
+        this->am.splice(this->am.end(), this->am, position->second.second);
+}
+
+void TwoQueuePolicy::recordRemove(uint64_t pageKey)
+{
+    auto position = this->positions.find(pageKey);
+    if (position == this->positions.end())
+        return;
+    if (position->second.first == A1IN)
+        this->a1in.erase(position->second.second);
+    else
+        this->am.erase(position->second.second);
+    this->positions.erase(position);
+}
+
+bool TwoQueuePolicy::pickVictim(function<bool(uint64_t)> isEvictable, uint64_t &victim)
+{
+    size_t a1inTarget = max(1u, BLOCK_COUNT / 4);
+    list<uint64_t> *queues[2] = {&this->a1in, &this->am};
+    if (this->a1in.size() <= a1inTarget)
+        swap(queues[0], queues[1]);
+    for (list<uint64_t> *queue : queues)
+    {
+        for (uint64_t pageKey : *queue)
+        {
+            if (!isEvictable(pageKey))
+                continue;
+            victim = pageKey;
+            bool fromA1in = queue == &this->a1in;
+            this->recordRemove(pageKey);
+            if (fromA1in)
+                this->remember(pageKey);
+            return true;
+        }
+    }
+    return false;
+}
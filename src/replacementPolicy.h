@@ -0,0 +1,151 @@
+#include"page.h"
+
+/**
+ * @brief A ReplacementPolicy decides which frame of the buffer pool is given
+ * up when a new page has to be read in. The buffer manager tells the policy
+ * about every page that enters the pool (recordInsert), every hit on a
+ * resident page (recordAccess) and every page that leaves the pool for any
+ * other reason than eviction (recordRemove). Pages are identified by the
+ * frame table key of the buffer manager.
+ *
+ * <p>
+ * pickVictim walks the candidates in the order the policy would like to evict
+ * them and returns the first one for which isEvictable holds, i.e. the first
+ * frame that is not pinned. The victim is forgotten by the policy before
+ * pickVictim returns.
+ * </p>
+ */
+class ReplacementPolicy{
+
+    public:
+
+    virtual ~ReplacementPolicy() {}
+    virtual string getName() = 0;
+    virtual void recordInsert(uint64_t pageKey) = 0;
+    virtual void recordAccess(uint64_t pageKey) = 0;
+    virtual void recordRemove(uint64_t pageKey) = 0;
+    virtual bool pickVictim(function<bool(uint64_t)> isEvictable, uint64_t &victim) = 0;
+};
+
+/**
+ * @brief Evicts pages in the order they were read in. Hits do not change the
+ * order.
+ */
+class FIFOPolicy : public ReplacementPolicy{
+
+    list<uint64_t> queue;
+    unordered_map<uint64_t, list<uint64_t>::iterator> positions;
+
+    public:
+
+    string getName() { return "FIFO"; }
+    void recordInsert(uint64_t pageKey);
+    void recordAccess(uint64_t pageKey);
+    void recordRemove(uint64_t pageKey);
+    bool pickVictim(function<bool(uint64_t)> isEvictable, uint64_t &victim);
+};
+
+/**
+ * @brief Evicts the least recently used page.
+ */
+class LRUPolicy : public ReplacementPolicy{
+
+    list<uint64_t> recency;
+    unordered_map<uint64_t, list<uint64_t>::iterator> positions;
+
+    public:
+
+    string getName() { return "LRU"; }
+    void recordInsert(uint64_t pageKey);
+    void recordAccess(uint64_t pageKey);
+    void recordRemove(uint64_t pageKey);
+    bool pickVictim(function<bool(uint64_t)> isEvictable, uint64_t &victim);
+};
+
+/**
+ * @brief Second chance approximation of LRU. Pages sit on a circular list
+ * with a reference bit that is set on every hit; the clock hand clears set
+ * bits as it sweeps and evicts the first page whose bit is already clear.
+ */
+class ClockPolicy : public ReplacementPolicy{
+
+    struct ClockEntry{
+        uint64_t pageKey;
+        bool referenced;
+    };
+
+    list<ClockEntry> ring;
+    list<ClockEntry>::iterator hand;
+    unordered_map<uint64_t, list<ClockEntry>::iterator> positions;
+
+    public:
+
+    ClockPolicy() { this->hand = this->ring.end(); }
+    string getName() { return "CLOCK"; }
+    void recordInsert(uint64_t pageKey);
+    void recordAccess(uint64_t pageKey);
+    void recordRemove(uint64_t pageKey);
+    bool pickVictim(function<bool(uint64_t)> isEvictable, uint64_t &victim);
+};
+
+/**
+ * @brief LRU-K (O'Neil et al.) with K = 2. The victim is the page whose K-th
+ * most recent reference lies furthest in the past; pages referenced fewer
+ * than K times are evicted first, least recently used among them first. The
+ * reference history of evicted pages is retained for up to BLOCK_COUNT pages
+ * so a page that comes back quickly is recognised as hot.
+ */
+class LRUKPolicy : public ReplacementPolicy{
+
+    static const int K = 2;
+    typedef tuple<int, uint64_t, uint64_t> Priority;
+
+    uint64_t clock = 0;
+    unordered_map<uint64_t, deque<uint64_t>> history;
+    list<uint64_t> retained;
+    unordered_map<uint64_t, list<uint64_t>::iterator> retainedPositions;
+    set<Priority> resident;
+    unordered_map<uint64_t, Priority> priorities;
+
+    Priority getPriority(uint64_t pageKey);
+    void reference(uint64_t pageKey);
+
+    public:
+
+    string getName() { return "LRU-K"; }
+    void recordInsert(uint64_t pageKey);
+    void recordAccess(uint64_t pageKey);
+    void recordRemove(uint64_t pageKey);
+    bool pickVictim(function<bool(uint64_t)> isEvictable, uint64_t &victim);
+};
+
+/**
+ * @brief The full 2Q policy (Johnson and Shasha). Pages seen for the first
+ * time enter a FIFO queue A1in holding about a quarter of the pool; pages
+ * evicted from A1in are remembered in the ghost queue A1out, and only a page
+ * that is referenced again while remembered there is promoted to the LRU
+ * queue Am. A single sequential scan therefore cycles through A1in and cannot
+ * flush the hot pages kept in Am.
+ */
+class TwoQueuePolicy : public ReplacementPolicy{
+
+    enum QueueName { A1IN, AM };
+
+    list<uint64_t> a1in;
+    list<uint64_t> am;
+    list<uint64_t> a1out;
+    unordered_map<uint64_t, pair<QueueName, list<uint64_t>::iterator>> positions;
+    unordered_map<uint64_t, list<uint64_t>::iterator> ghostPositions;
+
+    void remember(uint64_t pageKey);
+
+    public:
+
+    string getName() { return "2Q"; }
+    void recordInsert(uint64_t pageKey);
+    void recordAccess(uint64_t pageKey);
+    void recordRemove(uint64_t pageKey);
+    bool pickVictim(function<bool(uint64_t)> isEvictable, uint64_t &victim);
+};
+
+ReplacementPolicy *createReplacementPolicy(string policyName);
@@ -175,15 +175,16 @@ bool SecondaryIndex::createIndex()
   int totalRecords = 0;
 
   // Get a cursor to scan the table
-  Cursor cursor = table->getCursor();
-  vector<int> row = cursor.getNext();
-  int pageNo = 0;
-  int recordNo = 0;
+  // Only the indexed column is read; the cursor position gives the location
+  Cursor cursor = table->getCursor({columnIndex});
+  span<const int> row = cursor.getNextView();
 
   while (!row.empty())
   {
     // Get the value from the indexed column
-    int fieldValue = row[columnIndex];
+    int fieldValue = row[0];
+    int pageNo = cursor.pageIndex;
+    int recordNo = cursor.pagePointer - 1;
 
     // Add to current batch
     currentBatch.push_back(make_tuple(fieldValue, pageNo, recordNo));
@@ -218,18 +219,8 @@ bool SecondaryIndex::createIndex()
     }
 
     // Get next row
-    row = cursor.getNext();
-
-    // Update page and record position tracking
-    recordNo++;
+    row = cursor.getNextView();
     totalRecords++;
-
-    // Logic to track page boundaries - adjust as needed based on your cursor implementation
-    if (recordNo >= table->maxRowsPerBlock)
-    {
-      pageNo++;
-      recordNo = 0;
-    }
   }
 
   // Write any remaining records to a final temp file
@@ -940,3 +931,41 @@ vector<string> SecondaryIndex::findMatchingBPFiles(const string &searchOperator,
 
   return matchingBPFiles;
 }
+
+void SecondaryIndex::rebuildIndexes(string tableName)
+{
+  logger.log("SecondaryIndex::rebuildIndexes on " + tableName);
+  Table *table = tableCatalogue.getTable(tableName);
+  if (!table)
+    return;
+  for (const string &columnName : table->columns)
+  {
+    if (!filesystem::exists("../data/indices/" + tableName + "_" + columnName + "_Indexfile_0"))
+      continue;
+    SecondaryIndex index(tableName, columnName);
+    index.createIndex();
+  }
+  filesystem::remove("../data/indices/" + tableName + "_IndexesStale");
+}
+
+void SecondaryIndex::markIndexesStale(string tableName)
+{
+  Table *table = tableCatalogue.getTable(tableName);
+  if (!table)
+    return;
+  for (const string &columnName : table->columns)
+  {
+    if (filesystem::exists("../data/indices/" + tableName + "_" + columnName + "_Indexfile_0"))
+    {
+      // The marker is a file so that it survives a restart with --persist
+      ofstream("../data/indices/" + tableName + "_IndexesStale");
+      return;
+    }
+  }
+}
+
+void SecondaryIndex::refreshIndexes(string tableName)
+{
+  if (filesystem::exists("../data/indices/" + tableName + "_IndexesStale"))
+    rebuildIndexes(tableName);
+}
@@ -96,6 +96,31 @@ public:
   string getColumnName() const;
   bool updateIndex(int newValue);
 
+  /**
+   * @brief Rebuild every existing index of a table, after rows were added to
+   * it or moved within it and the indices no longer point at them
+   *
+   * @param tableName Name of the table
+   */
+  static void rebuildIndexes(string tableName);
+
+  /**
+   * @brief Note that rows were added to a table without updating its indices.
+   * The indices are rebuilt by the next refreshIndexes, so a run of inserts
+   * costs one rebuild instead of one per row
+   *
+   * @param tableName Name of the table
+   */
+  static void markIndexesStale(string tableName);
+
+  /**
+   * @brief Rebuild the indices of a table if they were marked stale. Called
+   * before an index of the table is read
+   *
+   * @param tableName Name of the table
+   */
+  static void refreshIndexes(string tableName);
+
 
   /*
   * Finds the index file that might contain the given value
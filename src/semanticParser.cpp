@@ -29,6 +29,9 @@ bool semanticParse(){
         case DELETE: return semanticParseDELETE();
         case INSERT: return semanticParseINSERT();
         case UPDATE: return semanticParseUPDATE();
+        case SET_BUFFER_POLICY: return semanticParseSETBUFFERPOLICY();
+        case PRINT_BUFFER: return semanticParsePRINTBUFFER();
+        case ANALYZE: return semanticParseANALYZE();
         default: cout<<"SEMANTIC ERROR"<<endl;
     }
 
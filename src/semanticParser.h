@@ -27,4 +27,7 @@ bool semanticParseORDERBY();
 bool semanticParseSEARCH();
 bool semanticParseDELETE ();
 bool semanticParseINSERT();
-bool semanticParseUPDATE();
\ No newline at end of file
+bool semanticParseUPDATE();
+bool semanticParseSETBUFFERPOLICY();
+bool semanticParsePRINTBUFFER();
+bool semanticParseANALYZE();
\ No newline at end of file
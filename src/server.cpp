@@ -5,30 +5,116 @@ using namespace std;
 
 float BLOCK_SIZE = 1;
 uint BLOCK_COUNT = 10;
+uint PREFETCH_DEPTH = 4;
+uint THREAD_COUNT = 0;
+bool PERSIST = false;
 uint PRINT_COUNT = 2000;
 Logger logger;
 vector<string> tokenizedQuery;
 ParsedQuery parsedQuery;
-TableCatalogue tableCatalogue;
 BufferManager bufferManager;
+ThreadPool threadPool;
+TableCatalogue tableCatalogue;
 
+/**
+ * @brief Parses and runs one command. A command that reads a corrupted page
+ * is abandoned with an error instead of returning a result without the rows
+ * of that page.
+ */
 void doCommand()
 {
     logger.log("doCommand");
     if (syntacticParse() && semanticParse())
-        executeCommand();
+    {
+        try
+        {
+            executeCommand();
+        }
+        catch (const PageCorruptedError &error)
+        {
+            cout << "ERROR: " << error.what() << endl;
+        }
+    }
     return;
 }
 
-int main(void)
+/**
+ * @brief Startup flags:
+ *   --buffer-policy <FIFO|LRU|CLOCK|LRU-K|2Q>  replacement policy of the pool
+ *   --block-count <n>                          number of frames in the pool
+ *   --predicate-kernel <AVX2|SSE4|SCALAR>      instruction set of the scan predicates
+ *   --prefetch-depth <n>                       pages read ahead of a sequential scan (0 disables)
+ *   --read-path <PREAD|MMAP>                   copy pages into the pool or read them from mapped segments
+ *   --threads <n>                              worker threads of parallel operators (default: one per core)
+ *   --persist <ON|OFF>                         keep tables and indices across restarts (see TableCatalogue)
+ */
+bool parseFlags(int argc, char *argv[])
+{
+    for (int argCounter = 1; argCounter < argc; argCounter++)
+    {
+        string flag = argv[argCounter];
+        if (argCounter + 1 >= argc)
+        {
+            cout << "Missing value for " << flag << endl;
+            return false;
+        }
+        string value = argv[++argCounter];
+        if (flag == "--buffer-policy")
+        {
+            if (!bufferManager.setPolicy(value))
+            {
+                cout << "Unknown buffer policy " << value << endl;
+                return false;
+            }
+        }
+        else if (flag == "--read-path")
+        {
+            if (!bufferManager.setReadPath(value))
+            {
+                cout << "Unknown read path " << value << endl;
+                return false;
+            }
+        }
+        else if (flag == "--predicate-kernel")
+        {
+            if (!setPredicateKernel(value))
+            {
+                cout << "Predicate kernel " << value << " is not available" << endl;
+                return false;
+            }
+        }
+        else if (flag == "--block-count" && regex_match(value, regex("[1-9][0-9]*")))
+            BLOCK_COUNT = stoul(value);
+        else if (flag == "--threads" && regex_match(value, regex("[1-9][0-9]*")))
+            THREAD_COUNT = stoul(value);
+        else if (flag == "--prefetch-depth" && regex_match(value, regex("[0-9]+")))
+            PREFETCH_DEPTH = stoul(value);
+        else if (flag == "--persist" && (value == "ON" || value == "OFF"))
+            PERSIST = value == "ON";
+        else
+        {
+            cout << "Unknown flag " << flag << " " << value << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
 {
 
     regex delim("[^\\s,]+");
+    if (!parseFlags(argc, argv))
+        return 1;
     string command;
-    system("rm -rf ../data/temp");
+    // A warm start keeps the segments and indices of the tables it reopens
+    if (!PERSIST || !tableCatalogue.open("../data/temp/catalog"))
+    {
+        system("rm -rf ../data/temp");
+        system("rm -rf ../data/indices");
+        system("mkdir ../data/temp");
+    }
     system("rm -rf ../data/temp2");
-    system("rm -rf ../data/indices");
-    system("mkdir ../data/temp");
     system("mkdir ../data/temp2");
     // cout <<"hi"<<endl;
     while(!cin.eof())
@@ -48,9 +134,12 @@ int main(void)
 
         if (tokenizedQuery.size() == 1 && tokenizedQuery.front() == "QUIT")
         {
-          system("rm -rf ../data/temp");
           system("rm -rf ../data/temp2");
-          system("rm -rf ../data/indices");
+          if (!PERSIST)
+          {
+            system("rm -rf ../data/temp");
+            system("rm -rf ../data/indices");
+          }
           break;
         }
 
@@ -0,0 +1,254 @@
+#include "global.h"
+
+ColumnStatistics::ColumnStatistics(uint64_t seed)
+{
+    this->registers.assign(1 << HLL_PRECISION, 0);
+    this->randomState = seed;
+}
+
+/**
+ * @brief splitmix64: a small, fast generator that is good enough to drive the
+ * reservoir sample, and deterministic for a given seed.
+ *
+ * @return uint64_t
+ */
+uint64_t ColumnStatistics::nextRandom()
+{
+    uint64_t z = (this->randomState += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Spreads the bits of a value over a 64 bit hash (the splitmix64
+ * finaliser), as HyperLogLog needs uniformly distributed hashes.
+ *
+ * @param value
+ * @return uint64_t
+ */
+static uint64_t hashValue(int value)
+{
+    uint64_t z = (uint32_t)value + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Adds one value of the column.
+ *
+ * @param value
+ */
+void ColumnStatistics::add(int value)
+{
+    this->valueCount++;
+    this->minValue = min(this->minValue, value);
+    this->maxValue = max(this->maxValue, value);
+
+    // The first HLL_PRECISION bits pick the register, which keeps the
+    // longest run of leading zeros seen in the remaining bits
+    uint64_t hash = hashValue(value);
+    uint32_t registerIndex = hash >> (64 - HLL_PRECISION);
+    uint64_t remainingBits = (hash << HLL_PRECISION) | (1ULL << (HLL_PRECISION - 1));
+    this->registers[registerIndex] = max(this->registers[registerIndex], (uint8_t)(__builtin_clzll(remainingBits) + 1));
+
+    // Reservoir sampling: the n-th value replaces a random sample slot with
+    // probability SAMPLE_SIZE / n
+    this->sampledCount++;
+    if (this->sample.size() < SAMPLE_SIZE)
+        this->sample.push_back(value);
+    else
+    {
+        uint64_t slot = this->nextRandom() % this->sampledCount;
+        if (slot < SAMPLE_SIZE)
+            this->sample[slot] = value;
+    }
+}
+
+/**
+ * @brief Folds in the statistics of other values of the same column. The
+ * merged sample takes from each side in proportion to the number of values
+ * that side has seen, so it stays a uniform sample of the union.
+ *
+ * @param other
+ */
+void ColumnStatistics::merge(ColumnStatistics &other)
+{
+    for (size_t registerIndex = 0; registerIndex < this->registers.size(); registerIndex++)
+        this->registers[registerIndex] = max(this->registers[registerIndex], other.registers[registerIndex]);
+    this->minValue = min(this->minValue, other.minValue);
+    this->maxValue = max(this->maxValue, other.maxValue);
+    this->valueCount += other.valueCount;
+
+    long long totalSampled = this->sampledCount + other.sampledCount;
+    int keep = min<size_t>(SAMPLE_SIZE, this->sample.size() + other.sample.size());
+    if (totalSampled > 0 && keep > 0)
+    {
+        int fromThis = llround((double)keep * this->sampledCount / totalSampled);
+        fromThis = clamp(fromThis, max(0, keep - (int)other.sample.size()), (int)this->sample.size());
+        auto takeRandom = [&](vector<int> &from, int count, vector<int> &to) {
+            for (int taken = 0; taken < count; taken++)
+            {
+                swap(from[taken], from[taken + this->nextRandom() % (from.size() - taken)]);
+                to.push_back(from[taken]);
+            }
+        };
+        vector<int> merged;
+        takeRandom(this->sample, fromThis, merged);
+        takeRandom(other.sample, keep - fromThis, merged);
+        this->sample.swap(merged);
+    }
+    this->sampledCount = totalSampled;
+}
+
+/**
+ * @brief Cuts the equi-depth histogram from the sample. When the sample does
+ * not cover every value counted (statistics read back from disk that rows
+ * were added to since), the histogram is kept as it is until the next
+ * ANALYZE.
+ */
+void ColumnStatistics::buildHistogram()
+{
+    if (this->sampledCount != this->valueCount)
+        return;
+    this->histogramBounds.clear();
+    if (this->sample.empty())
+        return;
+    vector<int> sorted = this->sample;
+    sort(sorted.begin(), sorted.end());
+    for (int bucketCounter = 0; bucketCounter < HISTOGRAM_BUCKETS; bucketCounter++)
+        this->histogramBounds.push_back(sorted[(size_t)bucketCounter * sorted.size() / HISTOGRAM_BUCKETS]);
+    this->histogramBounds.push_back(sorted.back());
+    this->histogramBounds.front() = this->minValue;
+    this->histogramBounds.back() = this->maxValue;
+}
+
+/**
+ * @brief HyperLogLog estimate of the number of distinct values, with the
+ * linear counting correction for small cardinalities.
+ *
+ * @return long long
+ */
+long long ColumnStatistics::estimateDistinctCount() const
+{
+    if (this->valueCount == 0)
+        return 0;
+    double registerCount = this->registers.size();
+    double inverseSum = 0;
+    int zeroRegisters = 0;
+    for (uint8_t rank : this->registers)
+    {
+        inverseSum += ldexp(1.0, -rank);
+        zeroRegisters += (rank == 0);
+    }
+    double estimate = 0.7213 / (1 + 1.079 / registerCount) * registerCount * registerCount / inverseSum;
+    if (estimate <= 2.5 * registerCount && zeroRegisters)
+        estimate = registerCount * log(registerCount / zeroRegisters);
+    long long distinctCount = llround(estimate);
+    distinctCount = min(distinctCount, this->valueCount);
+    if (this->maxValue >= this->minValue)
+        distinctCount = min(distinctCount, (long long)this->maxValue - this->minValue + 1);
+    return max(distinctCount, 1LL);
+}
+
+/**
+ * @brief Writes the statistics on one line: value count, min, max, the
+ * histogram bounds and the HyperLogLog registers in hex. The sample is not
+ * written.
+ *
+ * @param fout
+ */
+void ColumnStatistics::write(ostream &fout) const
+{
+    fout << this->valueCount << " " << this->minValue << " " << this->maxValue << " " << this->histogramBounds.size();
+    for (int bound : this->histogramBounds)
+        fout << " " << bound;
+    static const char hexDigits[] = "0123456789abcdef";
+    string registerDigits(this->registers.size() * 2, '0');
+    for (size_t registerIndex = 0; registerIndex < this->registers.size(); registerIndex++)
+    {
+        registerDigits[registerIndex * 2] = hexDigits[this->registers[registerIndex] >> 4];
+        registerDigits[registerIndex * 2 + 1] = hexDigits[this->registers[registerIndex] & 15];
+    }
+    fout << " " << registerDigits << endl;
+}
+
+/**
+ * @brief Widens the ranges of the zone so they include row.
+ *
+ * @param row
+ */
+void ZoneMap::widen(span<const int> row)
+{
+    if (this->minValues.empty())
+    {
+        this->minValues.assign(row.begin(), row.end());
+        this->maxValues.assign(row.begin(), row.end());
+        return;
+    }
+    for (size_t columnCounter = 0; columnCounter < row.size(); columnCounter++)
+    {
+        this->minValues[columnCounter] = min(this->minValues[columnCounter], row[columnCounter]);
+        this->maxValues[columnCounter] = max(this->maxValues[columnCounter], row[columnCounter]);
+    }
+}
+
+/**
+ * @brief Writes the zone on one line: the number of columns, then the
+ * minimum and maximum of every column.
+ *
+ * @param fout
+ */
+void ZoneMap::write(ostream &fout) const
+{
+    fout << this->minValues.size();
+    for (size_t columnCounter = 0; columnCounter < this->minValues.size(); columnCounter++)
+        fout << " " << this->minValues[columnCounter] << " " << this->maxValues[columnCounter];
+    fout << endl;
+}
+
+/**
+ * @brief Reads back a line written by ZoneMap::write.
+ *
+ * @param fin
+ * @return true if the line was well formed
+ * @return false otherwise
+ */
+bool ZoneMap::read(istream &fin)
+{
+    size_t columnCount;
+    if (!(fin >> columnCount))
+        return false;
+    this->minValues.resize(columnCount);
+    this->maxValues.resize(columnCount);
+    for (size_t columnCounter = 0; columnCounter < columnCount; columnCounter++)
+        if (!(fin >> this->minValues[columnCounter] >> this->maxValues[columnCounter]))
+            return false;
+    return true;
+}
+
+/**
+ * @brief Reads back a line written by write.
+ *
+ * @param fin
+ * @return true if the line was well formed
+ * @return false otherwise
+ */
+bool ColumnStatistics::read(istream &fin)
+{
+    size_t boundCount;
+    string registerDigits;
+    if (!(fin >> this->valueCount >> this->minValue >> this->maxValue >> boundCount))
+        return false;
+    this->histogramBounds.resize(boundCount);
+    for (int &bound : this->histogramBounds)
+        fin >> bound;
+    if (!(fin >> registerDigits) || registerDigits.size() != this->registers.size() * 2)
+        return false;
+    for (size_t registerIndex = 0; registerIndex < this->registers.size(); registerIndex++)
+        this->registers[registerIndex] = stoi(registerDigits.substr(registerIndex * 2, 2), nullptr, 16);
+    this->sample.clear();
+    this->sampledCount = 0;
+    return true;
+}
\ No newline at end of file
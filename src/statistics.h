@@ -0,0 +1,66 @@
+#include"threadPool.h"
+
+/**
+ * @brief Bounded-memory statistics of one int column, kept up to date as rows
+ * are added and used to estimate sizes for planning. Memory does not depend
+ * on the number of rows or of distinct values.
+ *
+ * <p>
+ * The number of distinct values (NDV) is estimated with a HyperLogLog sketch
+ * of 2^HLL_PRECISION one-byte registers (about 1.6% standard error). The
+ * minimum, maximum and the count of values are exact; values are never null
+ * in this system, so the count is also the non-null count. An equi-depth
+ * histogram of HISTOGRAM_BUCKETS buckets is cut from a uniform reservoir
+ * sample of SAMPLE_SIZE values: bucket i holds the values between bounds i
+ * and i + 1, and every bucket holds about the same number of rows.
+ * </p>
+ * <p>
+ * Statistics collected by different threads over parts of a table can be
+ * merged. They are written with the table's segment header and refreshed by
+ * ANALYZE.
+ * </p>
+ */
+const int HLL_PRECISION = 12;
+const int SAMPLE_SIZE = 1024;
+const int HISTOGRAM_BUCKETS = 16;
+
+class ColumnStatistics{
+
+    vector<uint8_t> registers;
+    vector<int> sample;
+    long long sampledCount = 0;
+    uint64_t randomState;
+
+    uint64_t nextRandom();
+
+    public:
+
+    long long valueCount = 0;
+    int minValue = INT_MAX;
+    int maxValue = INT_MIN;
+    vector<int> histogramBounds;
+
+    ColumnStatistics(uint64_t seed = 0);
+    void add(int value);
+    void merge(ColumnStatistics &other);
+    void buildHistogram();
+    long long estimateDistinctCount() const;
+    void write(ostream &fout) const;
+    bool read(istream &fin);
+};
+
+/**
+ * @brief Zone map of one block: the smallest and largest value of every
+ * column among the rows of the block. A scan with a predicate on a column
+ * can skip every block whose range cannot satisfy it (see zoneMayMatch).
+ * Zone maps are only ever widened when a block changes, so they stay correct,
+ * if loose, until ANALYZE tightens them again.
+ */
+struct ZoneMap{
+    vector<int> minValues;
+    vector<int> maxValues;
+
+    void widen(span<const int> row);
+    void write(ostream &fout) const;
+    bool read(istream &fin);
+};
\ No newline at end of file
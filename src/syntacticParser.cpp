@@ -36,6 +36,10 @@ bool syntacticParse()
       {
           return syntacticParsePRINTMATRIX();
       }
+      else if (tokenizedQuery[1]=="BUFFER")
+      {
+          return syntacticParsePRINTBUFFER();
+      }
       else
       {
           return syntacticParsePRINT();
@@ -74,6 +78,12 @@ bool syntacticParse()
     {
         return syntacticParseUPDATE();
     }
+    else if (possibleQueryType == "SET")
+    {
+        return syntacticParseSETBUFFERPOLICY();
+    }
+    else if (possibleQueryType == "ANALYZE")
+        return syntacticParseANALYZE();
     
 
     else
@@ -151,8 +161,12 @@ void ParsedQuery::clear()
     this->joinSecondRelationName = "";
     this->joinFirstColumnName = "";
     this->joinSecondColumnName = "";
+    this->joinSecondBinaryOperator = NO_BINOP_CLAUSE;
+    this->joinThirdColumnName = "";
+    this->joinFourthColumnName = "";
 
     this->loadRelationName = "";
+    this->loadLayout = ROW_MAJOR;
 
     this->printRelationName = "";
 
@@ -179,13 +193,17 @@ void ParsedQuery::clear()
 
     this->sourceFileName = "";
     this->groupByResultRelationName = "";
-    this->groupByAttribute = "";
+    this->groupByAttributes.clear();
     this->groupByTableName = "";
     this->havingAggregateFunc = "";
     this->havingAttribute = "";
     this->havingOperator = "";
     this->havingValue = 0;
+    this->returnAggregateFuncs.clear();
+    this->returnAttributes.clear();
 
+    this->bufferPolicyName = "";
+    this->analyzeRelationName = "";
 
 }
 
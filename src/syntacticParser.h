@@ -30,6 +30,9 @@ enum QueryType
   DELETE,
   INSERT,
 UPDATE,
+  SET_BUFFER_POLICY,
+  PRINT_BUFFER,
+  ANALYZE,
 
 };
 
@@ -79,7 +82,11 @@ public:
     string joinSecondRelationName = "";
     string joinFirstColumnName = "";
     string joinSecondColumnName = "";
+    BinaryOperator joinSecondBinaryOperator = NO_BINOP_CLAUSE;
+    string joinThirdColumnName = "";
+    string joinFourthColumnName = "";
     string loadRelationName = "";
+    PageLayout loadLayout = ROW_MAJOR;
     string printRelationName = "";
     string projectionResultRelationName = "";
     vector<string> projectionColumnList;
@@ -115,14 +122,14 @@ public:
     vector<string> sortColumnNames;
     vector<bool> sortingDirection; // true for ASC, false for DESC
     string groupByResultRelationName = "";
-    string groupByAttribute = "";
+    vector<string> groupByAttributes;
     string groupByTableName = "";
     string havingAggregateFunc = "";
     string havingAttribute = "";
     string havingOperator = "";
-    int havingValue = 0;
-    string returnAggregateFunc = "";
-    string returnAttribute = "";
+    long long havingValue = 0;
+    vector<string> returnAggregateFuncs;
+    vector<string> returnAttributes;
     string havingRelationName = "";
     string returnRelationName = "";
     string havingColumnName = "";
@@ -155,6 +162,9 @@ public:
     string updateRelationName = "";
     string updateClause = "";
 
+    string bufferPolicyName = "";
+    string analyzeRelationName = "";
+
 
 
 
@@ -194,3 +204,6 @@ bool syntacticParseGROUPBY();
 bool syntacticParseSEARCH();
 bool syntacticParseDELETE();
 bool syntacticParseUPDATE();
+bool syntacticParseSETBUFFERPOLICY();
+bool syntacticParsePRINTBUFFER();
+bool syntacticParseANALYZE();
@@ -66,6 +66,50 @@ bool Table::load()
     return false;
 }
 
+/**
+ * @brief Reopens a table whose blocks were written by an earlier server, from
+ * its segment header alone: the block geometry, row count, column statistics
+ * and zone maps are read back and no row is read. The name, source file and
+ * columns are expected to be set already.
+ *
+ * @return true if the header is complete and the segment holds every block
+ * it lists
+ * @return false otherwise
+ */
+bool Table::reopen()
+{
+    logger.log("Table::reopen");
+    ifstream fin(bufferManager.getSegmentName(this->tableName) + ".header");
+    uint columnCount;
+    int layout;
+    if (!(fin >> columnCount >> this->maxRowsPerBlock >> this->blockCount >> layout) || columnCount != this->columnCount)
+        return false;
+    this->layout = (PageLayout)layout;
+    this->rowsPerBlockCount.resize(this->blockCount);
+    for (uint &rowsInBlock : this->rowsPerBlockCount)
+        fin >> rowsInBlock;
+    if (!(fin >> this->rowCount))
+        return false;
+    this->columnStatistics.assign(this->columnCount, ColumnStatistics());
+    for (ColumnStatistics &statistics : this->columnStatistics)
+        if (!statistics.read(fin))
+            return false;
+    this->zoneMaps.assign(this->blockCount, ZoneMap());
+    for (ZoneMap &zoneMap : this->zoneMaps)
+        if (!zoneMap.read(fin))
+            return false;
+    fin.close();
+
+    // The last block is only as long as the rows it holds
+    struct stat segmentStatus;
+    if (stat(bufferManager.getSegmentName(this->tableName).c_str(), &segmentStatus) < 0)
+        return false;
+    if (this->blockCount == 0)
+        return true;
+    size_t lastBlockSize = sizeof(PageHeader) + (size_t)this->rowsPerBlockCount.back() * this->columnCount * sizeof(int);
+    return (size_t)segmentStatus.st_size >= (size_t)(this->blockCount - 1) * Page::pageSize() + lastBlockSize;
+}
+
 /**
  * @brief Function extracts column names from the header line of the .csv data
  * file. 
@@ -95,8 +139,94 @@ bool Table::extractColumnNames(string firstLine)
 }
 
 /**
- * @brief This function splits all the rows and stores them in multiple files of
- * one block size. 
+ * @brief The part of the source file given to one loader task, and what the
+ * task found in it. Blocks that lie wholly inside the chunk are written by
+ * the task itself; the rows of the (at most two) blocks the chunk shares with
+ * its neighbours are handed back as fragments.
+ */
+struct LoadChunk{
+    const char *begin;
+    const char *end;
+    long long firstRow = 0;
+    long long rowCount = 0;
+    vector<pair<uint, vector<int>>> fragments;
+    vector<ColumnStatistics> statistics;
+    bool failed = false;
+};
+
+/**
+ * @brief Calls function with the bounds of every non-empty line of
+ * [begin, end), without the line terminator. Stops early if function returns
+ * false.
+ *
+ * @return true if every line was accepted
+ */
+template <typename Function>
+static bool forEachLine(const char *begin, const char *end, Function function)
+{
+    while (begin < end)
+    {
+        const char *lineEnd = (const char *)memchr(begin, '\n', end - begin);
+        if (!lineEnd)
+            lineEnd = end;
+        const char *contentEnd = lineEnd;
+        if (contentEnd > begin && contentEnd[-1] == '\r')
+            contentEnd--;
+        if (contentEnd > begin && !function(begin, contentEnd))
+            return false;
+        begin = lineEnd + 1;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses columnCount comma separated integers from a line into row.
+ * Like stoi, leading blanks are skipped and anything after the digits of a
+ * field is ignored.
+ *
+ * @return true if the line holds columnCount integers that fit in an int
+ */
+static bool parseRow(const char *position, const char *lineEnd, int *row, int columnCount)
+{
+    for (int columnCounter = 0; columnCounter < columnCount; columnCounter++)
+    {
+        while (position < lineEnd && (*position == ' ' || *position == '\t'))
+            position++;
+        bool negative = position < lineEnd && *position == '-';
+        if (position < lineEnd && (*position == '-' || *position == '+'))
+            position++;
+        if (position >= lineEnd || !isdigit((unsigned char)*position))
+            return false;
+        long long value = 0;
+        while (position < lineEnd && isdigit((unsigned char)*position))
+        {
+            value = value * 10 + (*position++ - '0');
+            if (value > (long long)INT_MAX + 1)
+                return false;
+        }
+        value = negative ? -value : value;
+        if (value > INT_MAX)
+            return false;
+        row[columnCounter] = value;
+        while (position < lineEnd && *position != ',')
+            position++;
+        position++;
+    }
+    return true;
+}
+
+/**
+ * @brief This function splits all the rows and stores them as blocks of the
+ * table's segment file. 
+ *
+ * <p>
+ * The source file is mapped and cut into one chunk per worker thread at line
+ * boundaries. A first parallel pass counts the rows of every chunk, which
+ * fixes the block each row goes to; a second pass parses the chunks and
+ * writes their blocks concurrently. The few blocks that straddle two chunks
+ * are put together from both halves afterwards, so the blocks and
+ * rowsPerBlockCount come out exactly as a serial load would make them.
+ * </p>
  *
  * @return true if successfully blockified
  * @return false otherwise
@@ -104,69 +234,206 @@ bool Table::extractColumnNames(string firstLine)
 bool Table::blockify()
 {
     logger.log("Table::blockify");
-    ifstream fin(this->sourceFileName, ios::in);
-    string line, word;
-    vector<int> row(this->columnCount, 0);
-    vector<vector<int>> rowsInPage(this->maxRowsPerBlock, row);
-    int pageCounter = 0;
-    unordered_set<int> dummy;
-    dummy.clear();
-    this->distinctValuesInColumns.assign(this->columnCount, dummy);
-    this->distinctValuesPerColumnCount.assign(this->columnCount, 0);
-    getline(fin, line);
-    while (getline(fin, line))
+    int fd = open(this->sourceFileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat sourceStatus;
+    const char *source = nullptr;
+    if (fstat(fd, &sourceStatus) == 0 && sourceStatus.st_size > 0)
     {
-        stringstream s(line);
-        for (int columnCounter = 0; columnCounter < this->columnCount; columnCounter++)
+        source = (const char *)mmap(nullptr, sourceStatus.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (source == MAP_FAILED)
+            source = nullptr;
+    }
+    close(fd);
+    if (!source)
+        return false;
+    madvise((void *)source, sourceStatus.st_size, MADV_SEQUENTIAL);
+    const char *sourceEnd = source + sourceStatus.st_size;
+
+    // Skip the header line, then cut the rest at the first newline after
+    // every even split point
+    const char *dataBegin = (const char *)memchr(source, '\n', sourceStatus.st_size);
+    dataBegin = dataBegin ? dataBegin + 1 : sourceEnd;
+    const long long MIN_CHUNK_BYTES = 1 << 20;
+    int chunkCount = max(1LL, min((long long)threadPool.getThreadCount(), (sourceEnd - dataBegin) / MIN_CHUNK_BYTES));
+    vector<LoadChunk> chunks(chunkCount);
+    const char *chunkBegin = dataBegin;
+    for (int chunkCounter = 0; chunkCounter < chunkCount; chunkCounter++)
+    {
+        const char *chunkEnd = sourceEnd;
+        if (chunkCounter + 1 < chunkCount)
         {
-            if (!getline(s, word, ','))
-                return false;
-            row[columnCounter] = stoi(word);
-            rowsInPage[pageCounter][columnCounter] = row[columnCounter];
+            chunkEnd = max(chunkBegin, dataBegin + (sourceEnd - dataBegin) * (chunkCounter + 1) / chunkCount);
+            const char *newline = (const char *)memchr(chunkEnd, '\n', sourceEnd - chunkEnd);
+            chunkEnd = newline ? newline + 1 : sourceEnd;
         }
-        pageCounter++;
-        this->updateStatistics(row);
-        if (pageCounter == this->maxRowsPerBlock)
+        chunks[chunkCounter].begin = chunkBegin;
+        chunks[chunkCounter].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    threadPool.parallelFor(chunkCount, [&](int chunkCounter) {
+        LoadChunk &chunk = chunks[chunkCounter];
+        forEachLine(chunk.begin, chunk.end, [&](const char *, const char *) {
+            chunk.rowCount++;
+            return true;
+        });
+    });
+    long long totalRows = 0;
+    for (LoadChunk &chunk : chunks)
+    {
+        chunk.firstRow = totalRows;
+        totalRows += chunk.rowCount;
+    }
+
+    // Rows are numbered from the first block this call writes
+    uint firstBlock = this->blockCount;
+    uint rowsPerBlock = this->maxRowsPerBlock;
+    uint blocksWritten = (totalRows + rowsPerBlock - 1) / rowsPerBlock;
+    this->zoneMaps.resize(firstBlock + blocksWritten);
+    bufferManager.getSegment(this->tableName);
+    threadPool.parallelFor(chunkCount, [&](int chunkCounter) {
+        LoadChunk &chunk = chunks[chunkCounter];
+        chunk.statistics.assign(this->columnCount, ColumnStatistics(chunkCounter));
+        vector<int> block;
+        block.reserve((size_t)rowsPerBlock * this->columnCount);
+        long long rowIndex = chunk.firstRow;
+        // A block is written here only if all its rows belong to this chunk
+        auto emitBlock = [&]() {
+            if (block.empty())
+                return;
+            long long blockFirstRow = rowIndex - block.size() / this->columnCount;
+            uint blockIndex = blockFirstRow / rowsPerBlock;
+            bool wholeBlock = blockFirstRow % rowsPerBlock == 0 && (rowIndex % rowsPerBlock == 0 || rowIndex == totalRows);
+            if (wholeBlock)
+            {
+                Page(this->tableName, firstBlock + blockIndex, block, this->columnCount, this->layout).writePage();
+                for (size_t offset = 0; offset < block.size(); offset += this->columnCount)
+                    this->zoneMaps[firstBlock + blockIndex].widen(span<const int>(block.data() + offset, this->columnCount));
+            }
+            else
+                chunk.fragments.emplace_back(blockIndex, block);
+            block.clear();
+        };
+        chunk.failed = !forEachLine(chunk.begin, chunk.end, [&](const char *lineBegin, const char *lineEnd) {
+            block.resize(block.size() + this->columnCount);
+            int *row = block.data() + block.size() - this->columnCount;
+            if (!parseRow(lineBegin, lineEnd, row, this->columnCount))
+                return false;
+            for (int columnCounter = 0; columnCounter < this->columnCount; columnCounter++)
+                chunk.statistics[columnCounter].add(row[columnCounter]);
+            if (++rowIndex % rowsPerBlock == 0)
+                emitBlock();
+            return true;
+        });
+        if (!chunk.failed)
+            emitBlock();
+    });
+    munmap((void *)source, sourceStatus.st_size);
+
+    // Stitch the straddling blocks together from their fragments, which are
+    // already in row order because the chunks are
+    map<uint, vector<int>> straddlingBlocks;
+    for (LoadChunk &chunk : chunks)
+    {
+        if (chunk.failed)
+            return false;
+        for (auto &fragment : chunk.fragments)
         {
-            bufferManager.writePage(this->tableName, this->blockCount, rowsInPage, pageCounter);
-            this->blockCount++;
-            this->rowsPerBlockCount.emplace_back(pageCounter);
-            pageCounter = 0;
+            vector<int> &block = straddlingBlocks[fragment.first];
+            block.insert(block.end(), fragment.second.begin(), fragment.second.end());
         }
     }
-    if (pageCounter)
+    for (auto &block : straddlingBlocks)
     {
-        bufferManager.writePage(this->tableName, this->blockCount, rowsInPage, pageCounter);
-        this->blockCount++;
-        this->rowsPerBlockCount.emplace_back(pageCounter);
-        pageCounter = 0;
+        Page(this->tableName, firstBlock + block.first, block.second, this->columnCount, this->layout).writePage();
+        for (size_t offset = 0; offset < block.second.size(); offset += this->columnCount)
+            this->widenZoneMap(firstBlock + block.first, span<const int>(block.second.data() + offset, this->columnCount));
     }
 
+    bufferManager.forgetPages(this->tableName, firstBlock, blocksWritten);
+    for (uint blockCounter = 0; blockCounter < blocksWritten; blockCounter++)
+        this->rowsPerBlockCount.emplace_back(min((long long)rowsPerBlock, totalRows - (long long)blockCounter * rowsPerBlock));
+    this->blockCount += blocksWritten;
+    this->rowCount += totalRows;
+
+    if (this->columnStatistics.size() != this->columnCount)
+        this->columnStatistics.assign(this->columnCount, ColumnStatistics());
+    for (int columnCounter = 0; columnCounter < this->columnCount; columnCounter++)
+        for (LoadChunk &chunk : chunks)
+            this->columnStatistics[columnCounter].merge(chunk.statistics[columnCounter]);
+
     if (this->rowCount == 0)
         return false;
-    this->distinctValuesInColumns.clear();
+    this->writeSegmentHeader();
     return true;
 }
 
 /**
  * @brief Given a row of values, this function will update the statistics it
  * stores i.e. it updates the number of rows that are present in the column and
- * the number of distinct values present in each column. These statistics are to
- * be used during optimisation.
+ * the statistics of each column (see ColumnStatistics). These statistics are
+ * to be used during optimisation.
  *
  * @param row 
  */
-void Table::updateStatistics(vector<int> row)
+void Table::updateStatistics(span<const int> row)
 {
     this->rowCount++;
+    if (this->columnStatistics.size() != this->columnCount)
+        this->columnStatistics.assign(this->columnCount, ColumnStatistics());
     for (int columnCounter = 0; columnCounter < this->columnCount; columnCounter++)
+        this->columnStatistics[columnCounter].add(row[columnCounter]);
+}
+
+/**
+ * @brief Forgets the row count, column statistics and zone maps, before the
+ * rows of the table are written anew.
+ */
+void Table::resetStatistics()
+{
+    this->rowCount = 0;
+    this->columnStatistics.assign(this->columnCount, ColumnStatistics());
+    this->zoneMaps.clear();
+}
+
+/**
+ * @brief Widens the zone map of a block so it covers row, adding zone maps
+ * for blocks that do not have one yet.
+ *
+ * @param blockIndex
+ * @param row
+ */
+void Table::widenZoneMap(uint blockIndex, span<const int> row)
+{
+    if (this->zoneMaps.size() <= blockIndex)
+        this->zoneMaps.resize(blockIndex + 1);
+    this->zoneMaps[blockIndex].widen(row);
+}
+
+/**
+ * @brief Recomputes the statistics of every column and the zone map of every
+ * block from the rows currently in the table and stores them with the
+ * segment header. Used by ANALYZE once UPDATE or DELETE have made them stale.
+ */
+void Table::analyze()
+{
+    logger.log("Table::analyze");
+    this->resetStatistics();
+    this->zoneMaps.resize(this->blockCount);
+    vector<int> row(this->columnCount);
+    for (uint blockCounter = 0; blockCounter < this->blockCount; blockCounter++)
     {
-        if (!this->distinctValuesInColumns[columnCounter].count(row[columnCounter]))
+        PageHandle page = bufferManager.getPage(this->tableName, blockCounter);
+        for (int rowCounter = 0; rowCounter < page->getNumRecords(); rowCounter++)
         {
-            this->distinctValuesInColumns[columnCounter].insert(row[columnCounter]);
-            this->distinctValuesPerColumnCount[columnCounter]++;
+            page->copyRow(rowCounter, {}, row.data());
+            this->updateStatistics(row);
+            this->zoneMaps[blockCounter].widen(row);
         }
     }
+    this->writeSegmentHeader();
 }
 
 /**
@@ -189,6 +456,19 @@ bool Table::isColumn(string columnName)
     return false;
 }
 
+/**
+ * @brief Whether the rows are known to be stored in ascending order of the
+ * given column.
+ *
+ * @param columnName 
+ * @return true 
+ * @return false 
+ */
+bool Table::isSortedOn(string columnName)
+{
+    return !this->sortColumns.empty() && this->sortColumns.front() == columnName && this->sortDirections.front();
+}
+
 /**
  * @brief Renames the column indicated by fromColumnName to toColumnName. It is
  * assumed that checks such as the existence of fromColumnName and the non prior
@@ -208,6 +488,7 @@ void Table::renameColumn(string fromColumnName, string toColumnName)
             break;
         }
     }
+    replace(this->sortColumns.begin(), this->sortColumns.end(), fromColumnName, toColumnName);
     return;
 }
 
@@ -239,19 +520,19 @@ void Table::print()
   vector<vector<int>> allRows;
 
   Cursor cursor(this->tableName, 0);
-  vector<int> row;
+  span<const int> row;
   int rowCounter = 0;
 
   while (rowCounter < count)
   {
-    row = cursor.getNext();
+    row = cursor.getNextView();
 
     // Break if no more rows
     if (row.empty())
       break;
 
     // Capture and print row
-    allRows.push_back(row);
+    allRows.emplace_back(row.begin(), row.end());
     // this->writeRow(row, cout);
 
     rowCounter++;
@@ -272,19 +553,23 @@ void Table::print()
 }
 
 /**
- * @brief This function returns one row of the table using the cursor object. It
- * returns an empty row is all rows have been read.
+ * @brief Moves the cursor on to the next page of the table, passing over the
+ * pages its page filter rejects. The cursor stays where it is if there is no
+ * such page.
  *
  * @param cursor 
- * @return vector<int> 
  */
 void Table::getNextPage(Cursor *cursor)
 {
     logger.log("Table::getNext");
 
-        if (cursor->pageIndex < this->blockCount - 1)
+        uint nextPageIndex = cursor->pageIndex + 1;
+        if (cursor->pageFilter)
+            while (nextPageIndex < this->blockCount && !cursor->pageFilter(nextPageIndex))
+                nextPageIndex++;
+        if (nextPageIndex < this->blockCount)
         {
-            cursor->nextPage(cursor->pageIndex+1);
+            cursor->nextPage(nextPageIndex);
         }
 }
 
@@ -307,10 +592,10 @@ void Table::makePermanent()
     this->writeRow(this->columns, fout);
 
     Cursor cursor(this->tableName, 0);
-    vector<int> row;
+    span<const int> row;
     for (int rowCounter = 0; rowCounter < this->rowCount; rowCounter++)
     {
-        row = cursor.getNext();
+        row = cursor.getNextView();
         this->writeRow(row, fout);
     }
     fout.close();
@@ -337,12 +622,42 @@ bool Table::isPermanent()
  */
 void Table::unload(){
     logger.log("Table::~unload");
-    for (int pageCounter = 0; pageCounter < this->blockCount; pageCounter++)
-        bufferManager.deleteFile(this->tableName, pageCounter);
+    bufferManager.deleteSegment(this->tableName);
     if (!isPermanent())
         bufferManager.deleteFile(this->sourceFileName);
 }
 
+/**
+ * @brief Writes the side header of the table's segment file. The header holds
+ * the column count, the block geometry, the page layout and the number of rows
+ * stored in each block, i.e. everything needed to address blocks inside the
+ * segment. It is followed by the row count, one line of statistics per
+ * column and one zone map line per block.
+ *
+ */
+void Table::writeSegmentHeader()
+{
+    logger.log("Table::writeSegmentHeader");
+    ofstream fout(bufferManager.getSegmentName(this->tableName) + ".header", ios::trunc);
+    fout << this->columnCount << " " << this->maxRowsPerBlock << " " << this->blockCount << " " << this->layout << endl;
+    for (int blockCounter = 0; blockCounter < this->blockCount; blockCounter++)
+    {
+        if (blockCounter != 0)
+            fout << " ";
+        fout << this->rowsPerBlockCount[blockCounter];
+    }
+    fout << endl;
+    fout << this->rowCount << endl;
+    for (ColumnStatistics &statistics : this->columnStatistics)
+    {
+        statistics.buildHistogram();
+        statistics.write(fout);
+    }
+    for (ZoneMap &zoneMap : this->zoneMaps)
+        zoneMap.write(fout);
+    fout.close();
+}
+
 /**
  * @brief Function that returns a cursor that reads rows from this table
  * 
@@ -354,6 +669,21 @@ Cursor Table::getCursor()
     Cursor cursor(this->tableName, 0);
     return cursor;
 }
+
+/**
+ * @brief Function that returns a cursor that reads only the given columns of
+ * every row, in the order they are listed. On PAX tables the cursor does not
+ * touch the minipages of the other columns.
+ *
+ * @param columnIndices 
+ * @return Cursor 
+ */
+Cursor Table::getCursor(vector<int> columnIndices)
+{
+    logger.log("Table::getCursor");
+    Cursor cursor(this->tableName, 0, columnIndices);
+    return cursor;
+}
 /**
  * @brief Function that returns the index of column indicated by columnName
  * 
@@ -376,47 +706,68 @@ vector<string> Table::getColumnNames()
   return this->columns;
 }
 
+/**
+ * @brief Appends a row to the last block of the table, starting a new block
+ * in the segment when the last one is full. A row added to an existing block
+ * only changes the cached frame; it is written back at the next flush.
+ *
+ * @param values 
+ * @return true if the row was written
+ * @return false otherwise
+ */
 bool Table::insertRow(vector<int> values)
 {
-    logger.log("Table::writeRow");
-    // Check if the current block is full
-    string blockPath="";
-    if (this->rowsPerBlockCount[this->blockCount] >= this->maxRowsPerBlock)
+    logger.log("Table::insertRow");
+    if (values.size() != this->columnCount)
+        return false;
+    if (this->blockCount == 0 || this->rowsPerBlockCount[this->blockCount - 1] >= this->maxRowsPerBlock)
     {
-        cout<<"Block is full.Creating new block."<<endl;
+        bufferManager.writePage(this->tableName, this->blockCount, {values}, 1, this->layout);
         this->blockCount++;
-        this->rowsPerBlockCount.emplace_back(0);
-        blockPath = "../data/temp/" + this->tableName + "_" + to_string(this->blockCount) + ".csv";
-        ofstream fout(blockPath, ios::out);
-        if (!fout)
-        {
-            cout << "ERROR: Unable to create block file" << endl;
-            return false;
-        }
-        // Write the header
-        this->writeRow(this->columns, fout);
-        this->rowsPerBlockCount[this->blockCount] = 0;
-        this->rowsPerBlockCount[this->blockCount]++;
-        fout.close();
+        this->rowsPerBlockCount.emplace_back(1);
     }
     else
     {
-        this->rowsPerBlockCount[this->blockCount]++;
-        blockPath = "../data/temp/" + this->tableName + "_" + to_string(this->blockCount) + ".csv";
-        // Open the block file in append mode
-        ofstream fout(blockPath, ios::app);
-        if (!fout)
-        {
-            cout << "ERROR: Unable to open block file" << endl;
-            return false;
-        }
-        // Write the row
-        this->writeRow(values, fout);
-        this->rowsPerBlockCount[this->blockCount]++;
-        fout.close();
-    
+        int lastBlock = this->blockCount - 1;
+        bufferManager.getPage(this->tableName, lastBlock)->appendRow(values);
+        this->rowsPerBlockCount[lastBlock]++;
     }
-    // Update the statistics
     this->updateStatistics(values);
+    this->widenZoneMap(this->blockCount - 1, values);
+    this->sortColumns.clear();
+    this->sortDirections.clear();
+    this->writeSegmentHeader();
     return true;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Writes a row view in the same comma seperated format as the
+ * templated writeRow, without first copying it into a vector.
+ *
+ * @param row 
+ * @param fout 
+ */
+void Table::writeRow(span<const int> row, ostream &fout)
+{
+    logger.log("Table::printRow");
+    for (int columnCounter = 0; columnCounter < row.size(); columnCounter++)
+    {
+        if (columnCounter != 0)
+            fout << ", ";
+        fout << row[columnCounter];
+    }
+    fout << endl;
+}
+
+/**
+ * @brief Appends a row view to the table's source file.
+ *
+ * @param row 
+ */
+void Table::writeRow(span<const int> row)
+{
+    logger.log("Table::printRow");
+    ofstream fout(this->sourceFileName, ios::app);
+    this->writeRow(row, fout);
+    fout.close();
+}
@@ -1,4 +1,4 @@
-#include "cursor.h"
+#include "statistics.h"
 
 enum IndexingStrategy
 {
@@ -15,42 +15,70 @@ enum IndexingStrategy
  * command and the second is to use assignment statements (SELECT, PROJECT,
  * JOIN, SORT, CROSS and DISTINCT). 
  *
+ * <p>
+ * Every table keeps a ColumnStatistics per column, collected as its blocks
+ * are written and stored with the segment header. They stay exact for row
+ * and value counts and min/max under INSERT; after UPDATE or DELETE they
+ * are refreshed by ANALYZE.
+ * </p>
+ * <p>
+ * Every block also has a ZoneMap, built as the block is written and stored
+ * with the segment header too. INSERT and UPDATE widen the zone of the
+ * blocks they change. Scans with a "column OP literal" condition hand a zone
+ * filter to their cursor to skip blocks that cannot hold a matching row.
+ * </p>
+ * <p>
+ * sortColumns and sortDirections record the order the rows are stored in,
+ * when it is known: they are set by SORT, ORDER BY and JOIN, which write
+ * their rows sorted, and cleared when an INSERT or UPDATE may break the
+ * order. JOIN uses them to pick a sort-merge join.
+ * </p>
  */
 class Table
 {
 
 public:
-    vector<unordered_set<int>> distinctValuesInColumns;
     string sourceFileName = "";
     string tableName = "";
     vector<string> columns;
-    vector<uint> distinctValuesPerColumnCount;
+    vector<ColumnStatistics> columnStatistics;
+    vector<ZoneMap> zoneMaps;
+    vector<string> sortColumns;
+    vector<bool> sortDirections;
     uint columnCount = 0;
     long long int rowCount = 0;
     uint blockCount = 0;
     uint maxRowsPerBlock = 0;
     vector<uint> rowsPerBlockCount;
+    PageLayout layout = ROW_MAJOR;
     bool indexed = false;
     string indexedColumn = "";
     IndexingStrategy indexingStrategy = NOTHING;
     
     bool extractColumnNames(string firstLine);
     bool blockify();
-    void updateStatistics(vector<int> row);
+    void updateStatistics(span<const int> row);
+    void resetStatistics();
+    void widenZoneMap(uint blockIndex, span<const int> row);
+    void analyze();
     Table();
     Table(string tableName);
     Table(string tableName, vector<string> columns);
     bool load();
+    bool reopen();
     bool isColumn(string columnName);
+    bool isSortedOn(string columnName);
     void renameColumn(string fromColumnName, string toColumnName);
     void print();
     void makePermanent();
     bool isPermanent();
     void getNextPage(Cursor *cursor);
     Cursor getCursor();
+    Cursor getCursor(vector<int> columnIndices);
     int getColumnIndex(string columnName);
     vector<string> getColumnNames();
     void unload();
+    void writeSegmentHeader();
     bool insertRow(vector<int> row);
     /**
  * @brief Static function that takes a vector of valued and prints them out in a
@@ -60,7 +88,7 @@ public:
  * @param row 
  */
 template <typename T>
-void writeRow(vector<T> row, ostream &fout)
+void writeRow(const vector<T> &row, ostream &fout)
 {
     logger.log("Table::printRow");
     for (int columnCounter = 0; columnCounter < row.size(); columnCounter++)
@@ -80,12 +108,14 @@ void writeRow(vector<T> row, ostream &fout)
  * @param row 
  */
 template <typename T>
-void writeRow(vector<T> row)
+void writeRow(const vector<T> &row)
 {
     logger.log("Table::printRow");
     ofstream fout(this->sourceFileName, ios::app);
     this->writeRow(row, fout);
     fout.close();
 }
+void writeRow(span<const int> row, ostream &fout);
+void writeRow(span<const int> row);
 int getNumPages() const { return blockCount; }
 };
\ No newline at end of file
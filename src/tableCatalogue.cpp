@@ -52,10 +52,117 @@ void TableCatalogue::print()
     printRowCount(rowCount);
 }
 
+/**
+ * @brief Makes the catalogue persistent and reopens the tables saved in the
+ * catalog file by the previous server, if there is one. A table whose
+ * segment no longer matches its catalog entry is left out.
+ *
+ * @param catalogFileName 
+ * @return true if a catalog file was found
+ * @return false otherwise, i.e. the server starts cold
+ */
+bool TableCatalogue::open(string catalogFileName)
+{
+    logger.log("TableCatalogue::open");
+    this->catalogFileName = catalogFileName;
+    ifstream fin(catalogFileName);
+    if (!fin)
+        return false;
+    string line;
+    while (getline(fin, line))
+    {
+        stringstream entry(line);
+        string tableName, sourceFileName;
+        uint columnCount, indexCount;
+        if (!(entry >> tableName >> sourceFileName >> columnCount))
+            continue;
+        Table *table = new Table();
+        table->tableName = tableName;
+        table->sourceFileName = sourceFileName;
+        table->columns.resize(columnCount);
+        for (string &column : table->columns)
+            entry >> column;
+        table->columnCount = columnCount;
+        entry >> indexCount;
+        for (uint indexCounter = 0; indexCounter < indexCount; indexCounter++)
+        {
+            string indexedColumn;
+            entry >> indexedColumn;
+            if (!filesystem::exists("../data/indices/" + tableName + "_" + indexedColumn + "_Indexfile_0"))
+                logger.log("TableCatalogue::open: index of " + tableName + "." + indexedColumn + " is missing");
+        }
+        bool complete = !entry.fail();
+        uint sortColumnCount;
+        if (entry >> sortColumnCount)
+            for (uint sortCounter = 0; sortCounter < sortColumnCount; sortCounter++)
+            {
+                string sortColumn;
+                bool ascending;
+                if (entry >> sortColumn >> ascending)
+                {
+                    table->sortColumns.push_back(sortColumn);
+                    table->sortDirections.push_back(ascending);
+                }
+            }
+        if (complete && table->reopen())
+            this->tables[tableName] = table;
+        else
+        {
+            logger.log("TableCatalogue::open: cannot reopen " + tableName);
+            delete table;
+        }
+    }
+    fin.close();
+    bufferManager.deleteFile(catalogFileName);
+    return true;
+}
+
+/**
+ * @brief Writes the catalog file, one line per table: name, source file,
+ * column count, columns, then the number of columns with a secondary index
+ * and those columns, then the number of sort columns and each sort column
+ * with its direction.
+ */
+void TableCatalogue::save()
+{
+    logger.log("TableCatalogue::save");
+    ofstream fout(this->catalogFileName, ios::trunc);
+    for (auto &table : this->tables)
+    {
+        fout << table.first << " " << table.second->sourceFileName << " " << table.second->columnCount;
+        vector<string> indexedColumns;
+        for (string &column : table.second->columns)
+        {
+            fout << " " << column;
+            if (filesystem::exists("../data/indices/" + table.first + "_" + column + "_Indexfile_0"))
+                indexedColumns.push_back(column);
+        }
+        fout << " " << indexedColumns.size();
+        for (string &column : indexedColumns)
+            fout << " " << column;
+        fout << " " << table.second->sortColumns.size();
+        for (size_t sortCounter = 0; sortCounter < table.second->sortColumns.size(); sortCounter++)
+            fout << " " << table.second->sortColumns[sortCounter] << " " << table.second->sortDirections[sortCounter];
+        fout << endl;
+    }
+    fout.close();
+}
+
+/**
+ * @brief A persistent catalogue writes back every dirty page and saves
+ * itself, leaving the tables' files for the next server. Otherwise every
+ * table is unloaded.
+ */
 TableCatalogue::~TableCatalogue(){
     logger.log("TableCatalogue::~TableCatalogue"); 
+    if (!this->catalogFileName.empty())
+    {
+        bufferManager.flushPool();
+        this->save();
+    }
     for(auto table: this->tables){
-        table.second->unload();
+        if (this->catalogFileName.empty())
+            table.second->unload();
         delete table.second;
     }
 }
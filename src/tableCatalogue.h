@@ -5,14 +5,29 @@
  * system. Everytime a table is added(removed) to(from) the system, it needs to
  * be added(removed) to(from) the tableCatalogue. 
  *
+ * <p>
+ * A catalogue opened on a catalog file (--persist ON) outlives the server.
+ * On shutdown it writes every dirty page back and saves one line per table
+ * to the file: its name, source file, columns, the columns that have a
+ * secondary index and the order its rows are sorted in. Everything else
+ * about a table (block geometry, row count, statistics and zone maps) is
+ * already kept in its segment header. The next server reopens the tables
+ * from the catalog and their headers without reading any data. The catalog
+ * file is removed once it has been read, so a server that dies without a
+ * clean shutdown leaves none and the next one starts cold.
+ * </p>
  */
 class TableCatalogue
 {
 
     unordered_map<string, Table*> tables;
+    string catalogFileName = "";
+
+    void save();
 
 public:
     TableCatalogue() {}
+    bool open(string catalogFileName);
     void insertTable(Table* table);
     void deleteTable(string tableName);
     Table* getTable(string tableName);
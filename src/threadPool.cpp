@@ -0,0 +1,85 @@
+#include "global.h"
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(this->poolMutex);
+        this->stopping = true;
+    }
+    this->taskQueued.notify_all();
+    for (thread &worker : this->workers)
+        worker.join();
+}
+
+/**
+ * @brief Number of worker threads: THREAD_COUNT if it was set with --threads,
+ * otherwise one per hardware thread.
+ *
+ * @return uint
+ */
+uint ThreadPool::getThreadCount()
+{
+    return THREAD_COUNT ? THREAD_COUNT : max(1u, thread::hardware_concurrency());
+}
+
+/**
+ * @brief Worker loop: runs queued tasks until the pool is stopped.
+ */
+void ThreadPool::run()
+{
+    unique_lock<mutex> lock(this->poolMutex);
+    while (true)
+    {
+        this->taskQueued.wait(lock, [&] { return this->stopping || !this->tasks.empty(); });
+        if (this->stopping)
+            return;
+        function<void()> task = move(this->tasks.front());
+        this->tasks.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+        if (--this->unfinishedTasks == 0)
+            this->tasksFinished.notify_all();
+    }
+}
+
+/**
+ * @brief Runs task(0) .. task(taskCount - 1) on the worker threads and waits
+ * for all of them. If tasks throw, the first exception is rethrown on the
+ * calling thread once every task has finished.
+ *
+ * @param taskCount
+ * @param task
+ */
+void ThreadPool::parallelFor(int taskCount, function<void(int)> task)
+{
+    logger.log("ThreadPool::parallelFor");
+    if (taskCount <= 1 || this->getThreadCount() == 1)
+    {
+        for (int taskCounter = 0; taskCounter < taskCount; taskCounter++)
+            task(taskCounter);
+        return;
+    }
+    unique_lock<mutex> lock(this->poolMutex);
+    while (this->workers.size() < this->getThreadCount())
+        this->workers.emplace_back(&ThreadPool::run, this);
+    exception_ptr failure;
+    for (int taskCounter = 0; taskCounter < taskCount; taskCounter++)
+        this->tasks.push_back([&, taskCounter] {
+            try
+            {
+                task(taskCounter);
+            }
+            catch (...)
+            {
+                lock_guard<mutex> failureLock(this->poolMutex);
+                if (!failure)
+                    failure = current_exception();
+            }
+        });
+    this->unfinishedTasks += taskCount;
+    this->taskQueued.notify_all();
+    this->tasksFinished.wait(lock, [&] { return this->unfinishedTasks == 0; });
+    if (failure)
+        rethrow_exception(failure);
+}
\ No newline at end of file
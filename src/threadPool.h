@@ -0,0 +1,35 @@
+#include"cursor.h"
+
+/**
+ * @brief A fixed set of worker threads shared by the operators that split
+ * their work into independent tasks (the parallel CSV loader, for one). The
+ * workers are started the first time they are needed and live until the
+ * server exits, so an operator does not pay for creating threads.
+ *
+ * <p>
+ * parallelFor runs task(0) .. task(taskCount - 1) on the workers and returns
+ * once all of them have finished. With a single worker thread, or a single
+ * task, the tasks simply run on the calling thread. Tasks must not call
+ * parallelFor themselves.
+ * </p>
+ */
+class ThreadPool{
+
+    vector<thread> workers;
+    mutex poolMutex;
+    condition_variable taskQueued;
+    condition_variable tasksFinished;
+    deque<function<void()>> tasks;
+    int unfinishedTasks = 0;
+    bool stopping = false;
+
+    void run();
+
+    public:
+
+    ~ThreadPool();
+    uint getThreadCount();
+    void parallelFor(int taskCount, function<void(int)> task);
+};
+
+extern ThreadPool threadPool;
\ No newline at end of file
@@ -0,0 +1,46 @@
+#!/bin/bash
+# Regression check: an index join must see every row of a table that was
+# sorted in place (SORT) or appended to (INSERT) after its index was built.
+#
+# usage: tests/index_join_after_sort.sh [path/to/server]
+# Run it after building src/server; it works in a scratch directory.
+
+server=$(realpath "${1:-$(dirname "$0")/../src/server}")
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+mkdir "$work/data" "$work/run"
+
+# S holds the join keys 0..6; B holds 300 rows whose y order is not their x
+# order, so SORT B BY y moves nearly every row to another page
+{ echo "p, q"; for ((i = 0; i < 40; i++)); do echo "$((i % 7)), $i"; done; } > "$work/data/S.csv"
+{ echo "x, y"; for ((i = 0; i < 300; i++)); do echo "$((i * 13 % 50)), $((i * 37 % 300))"; done; } > "$work/data/B.csv"
+
+cd "$work/run" && "$server" > "$work/out" 2>&1 <<'QUERIES'
+LOAD S
+LOAD B
+J0 <- JOIN S, B ON p , x
+INDEX ON B USING x
+SORT B BY y IN ASC
+J1 <- JOIN S, B ON p , x
+INSERT INTO B ( x = 3 )
+J2 <- JOIN S, B ON p , x
+QUIT
+QUERIES
+
+counts=($(grep -o "^Row Count: [0-9]*" "$work/out" | awk '{print $3}'))
+# J0, B after SORT, J1, J2
+if [ "${#counts[@]}" -ne 4 ]; then
+  echo "FAIL: unexpected server output"
+  cat "$work/out"
+  exit 1
+fi
+matchesOf3=$(awk -F, 'NR > 1 && $1 + 0 == 3' "$work/data/S.csv" | wc -l)
+if [ "${counts[2]}" -ne "${counts[0]}" ]; then
+  echo "FAIL: join after SORT returned ${counts[2]} rows, expected ${counts[0]}"
+  exit 1
+fi
+if [ "${counts[3]}" -ne $((counts[0] + matchesOf3)) ]; then
+  echo "FAIL: join after INSERT returned ${counts[3]} rows, expected $((counts[0] + matchesOf3))"
+  exit 1
+fi
+echo "PASS: ${counts[0]} rows joined before and after SORT, ${counts[3]} after INSERT"